@@ -5,6 +5,11 @@
 #include "solution.h"
 
 #include <set>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <unordered_map>
 
 using std::set;
 using std::multiset;
@@ -34,11 +39,6 @@ private:
     SearchNode* _parent;
 };
 
-class CmpByState
-{
-public:
-    bool operator()(SearchNode* a, SearchNode* b) const;
-};
 class CmpByPriority
 {
 public:
@@ -68,8 +68,8 @@ private:
     bool wasExpanded(SearchNode* node) const;
     // sort by priority
     multiset<SearchNode*, CmpByPriority> _open;
-    // sort by state
-    set<SearchNode*, CmpByState> _closed;
+    // by key of state
+    std::unordered_map<uint64_t, SearchNode*, KeyHash> _closed;
 };
 
 class IAstarChecker
@@ -81,8 +81,61 @@ public:
     virtual const std::vector<Action>& getActions() = 0;
     virtual const Action& getZeroAction() = 0;
     virtual CostType heuristic(const JointState& state) = 0;
+    // limits of joints for successors which are checked before isCorrect
+    virtual const JointLimits& getLimits();
+};
+
+using Clock = std::chrono::steady_clock;
+
+/*
+Shared flag to stop planning from another thread.
+Copies of token refer to the same flag.
+*/
+class CancellationToken
+{
+public:
+    CancellationToken();
+
+    void cancel() const;
+    bool isCancelled() const;
+
+private:
+    std::shared_ptr<std::atomic<bool>> _cancelled;
 };
 
+struct SearchProgress
+{
+    size_t expansions = 0;
+    CostType bestF = 0; // f-value of the last expanded node, it does not decrease for consistent heuristic
+    vector<size_t> incumbentPath; // ids of actions to the expanded node with minimal heuristic
+};
+
+/*
+Stop conditions of search. They are checked every checkPeriod expansions,
+so checks do not slow down the search.
+*/
+struct SearchControl
+{
+    // without deadline
+    SearchControl();
+    // deadline is timeLimit *seconds* of wall time from now
+    explicit SearchControl(double timeLimit);
+
+    bool shouldStop() const;
+    // shouldStop() which is checked only every checkPeriod expansions
+    bool shouldStop(size_t expansions) const;
+
+    Clock::time_point deadline;
+    CancellationToken token;
+    size_t checkPeriod = 64; // 0 is the same as 1
+    // is called every progressPeriod expansions from planning thread, 0 - never
+    size_t progressPeriod = 0;
+    std::function<void(const SearchProgress&)> onProgress;
+};
+
+// returns ids of actions from root of search tree to node
+vector<size_t> extractPath(SearchNode* node);
+
 // allocates on heap and returns successors
 vector<SearchNode*> generateSuccessors(
     SearchNode* node,
@@ -96,5 +149,11 @@ Solution astar(
     double weight = 1.0,
     double timeLimit = 1.0
 );
+Solution astar(
+    const JointState& startPos,
+    IAstarChecker& checker,
+    double weight,
+    const SearchControl& control
+);
 
 } // namespace astar
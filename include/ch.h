@@ -0,0 +1,56 @@
+#pragma once
+
+#include "lattice.h"
+#include "solution.h"
+
+#include <memory>
+
+/*
+Contraction hierarchy over free states of lattice for fast optimal queries
+with many different starts and goals on static scene.
+States are contracted one by one in order of edge difference, and shortcuts are
+added where witness search does not find another path of the same cost.
+Query is bidirectional Dijkstra which goes only up in hierarchy, then
+shortcuts of found path are unpacked to primitive actions.
+*/
+class ContractionHierarchy
+{
+public:
+    // builds hierarchy, it takes a few seconds for 2 dof
+    ContractionHierarchy(std::shared_ptr<const Lattice> lattice);
+    // loads hierarchy which was saved by save()
+    ContractionHierarchy(std::shared_ptr<const Lattice> lattice, const std::string& filename, uint64_t hash);
+
+    void save(const std::string& filename, uint64_t hash) const;
+
+    // primitiveActions must be in the same order as actions of lattice
+    Solution plan(const JointState& startPos, const JointState& goalPos,
+        const vector<Action>& primitiveActions, const Action& zeroAction) const;
+
+    // the number of edges in upward graphs, shortcuts included
+    size_t edges() const;
+    size_t shortcuts() const;
+
+    // edge of hierarchy, via >= 0 is middle state of shortcut, via < 0 is -(action + 1) for edge of lattice
+    struct Edge
+    {
+        uint32_t to;
+        uint32_t cost;
+        int32_t via;
+    };
+
+private:
+    void unpack(uint32_t from, uint32_t to, int32_t via, vector<size_t>& actions) const;
+    const Edge& findEdge(const vector<uint32_t>& begin, const vector<Edge>& edges, uint32_t state, uint32_t to) const;
+
+    std::shared_ptr<const Lattice> _lattice;
+
+    // graphs in compressed sparse row form, edges of state s are [begin[s], begin[s + 1])
+    vector<uint32_t> _forwardBegin;
+    vector<Edge> _forward; // edges from state to states with higher rank
+    vector<uint32_t> _backwardBegin;
+    vector<Edge> _backward; // edges to state from states with higher rank, to is source of edge
+};
+
+// loads lattice and hierarchy saved next to model file
+std::shared_ptr<ContractionHierarchy> loadContractionHierarchy(const ManipulatorPlanner& planner, const std::string& modelFilename);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "lattice.h"
+
+#include <memory>
+
+/*
+Labels of connected components of free lattice states. Planner uses them
+to answer PATH_NOT_EXISTS without search when start and goal are in different
+components. Labels are bit-packed (0 - state in obstacle), and for every
+component bounding box of end-effector positions is kept, so position tasks
+with goal out of the box are rejected too.
+The map does not need lattice after building, so it is cheap to keep it loaded.
+*/
+class ComponentMap
+{
+public:
+    // builds labels by parallel union-find, threads = 0 means the number of hardware threads
+    // planner is used to find positions of end-effector
+    ComponentMap(const Lattice& lattice, const ManipulatorPlanner& planner, size_t threads = 0);
+    // loads map which was saved by save()
+    ComponentMap(size_t dof, const std::string& filename, uint64_t hash);
+
+    void save(const std::string& filename, uint64_t hash) const;
+
+    size_t components() const;
+    // label of component from 1 to components(), 0 if state is in obstacle
+    size_t component(const JointState& state) const;
+    bool connected(const JointState& state1, const JointState& state2) const;
+    // false if end-effector can not reach point (x, y) with accuracy eps from state
+    bool mayReach(const JointState& state, double x, double y, double eps) const;
+
+private:
+    struct Box
+    {
+        float minX;
+        float minY;
+        float maxX;
+        float maxY;
+    };
+
+    size_t index(const JointState& state) const;
+    size_t label(size_t id) const;
+    void pack(const vector<uint32_t>& labels);
+
+    size_t _dof;
+    size_t _size;
+    size_t _bits; // bits in one label
+    vector<uint64_t> _labels;
+    vector<Box> _boxes; // by label - 1
+};
+
+// loads map saved next to model file
+std::shared_ptr<ComponentMap> loadComponentMap(const ManipulatorPlanner& planner, const std::string& modelFilename);
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "lattice.h"
+#include "solution.h"
+
+#include <memory>
+
+/*
+Compressed path database: for every source state and every target state it keeps
+the first action of optimal path. Row of source lists first actions for targets
+in Morton order (so close targets are neighbours in row), and every row is
+compressed by run-length encoding. Targets in obstacles do not matter and merge
+with neighbouring runs. Query does one lookup per action without any search.
+Memory grows as squared size of lattice, so only 1 and 2 dof are supported.
+*/
+class CompressedPathDatabase
+{
+public:
+    // builds database, threads = 0 means the number of hardware threads
+    CompressedPathDatabase(std::shared_ptr<const Lattice> lattice, size_t threads = 0);
+    // loads database which was saved by save()
+    CompressedPathDatabase(std::shared_ptr<const Lattice> lattice, const std::string& filename, uint64_t hash);
+
+    void save(const std::string& filename, uint64_t hash) const;
+
+    // primitiveActions must be in the same order as actions of lattice
+    Solution plan(const JointState& startPos, const JointState& goalPos,
+        const vector<Action>& primitiveActions, const Action& zeroAction) const;
+
+    // first action from source to target, noAction if target is unreachable
+    uint8_t firstAction(size_t source, size_t target) const;
+    // the number of runs in all rows
+    size_t runs() const;
+
+    static constexpr uint8_t noAction = 0xFF;
+
+private:
+    void initMorton();
+    vector<uint32_t> buildRow(size_t source, const vector<uint32_t>& targets,
+        vector<int>& dist, vector<uint8_t>& first, vector<size_t>& queue) const;
+
+    std::shared_ptr<const Lattice> _lattice;
+    vector<uint32_t> _morton; // Morton index of every state
+
+    // run is (Morton index of first target << 8) | action
+    vector<uint32_t> _rowBegin;
+    vector<uint32_t> _runs;
+};
+
+// loads lattice and database saved next to model file
+std::shared_ptr<CompressedPathDatabase> loadPathDatabase(const ManipulatorPlanner& planner, const std::string& modelFilename);
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "planner.h"
+
+#include <list>
+
+/*
+Experience cache keeps paths of solved tasks and reuses them for similar tasks.
+For new task it takes stored path with the closest ends (or path which ends
+near goal point for position tasks), connects start and goal to its ends
+by short local A* searches and checks reused actions by checkCollisionAction.
+If there is no suitable path or reused path is blocked, full A* is run and
+its solution is stored. The least recently used paths are evicted when
+the cache is full. Cache can be saved to file and loaded in the next run.
+*/
+class ExperienceCache
+{
+public:
+    // capacity - the maximum number of stored paths
+    ExperienceCache(ManipulatorPlanner& planner, size_t capacity = 1024);
+
+    Solution planActions(const JointState& startPos, const JointState& goalPos,
+        double timeLimit = 1.0, double w = 1.0);
+    Solution planActions(const JointState& startPos, double goalX, double goalY,
+        double timeLimit = 1.0, double w = 1.0);
+
+    void save(const std::string& filename) const;
+    // returns false if file does not exist, throws if file is broken or is made for another model
+    bool load(const std::string& filename);
+
+    size_t size() const;
+    // the number of tasks solved by reused paths
+    size_t hits() const;
+
+    // the maximum manhattan distance between task and stored path ends which local search connects
+    size_t maxRepairDistance = 16;
+
+private:
+    struct Experience
+    {
+        vector<JointState> path; // states from start to goal
+        double endX; // position of end-effector at the end of path
+        double endY;
+    };
+    using Iterator = std::list<Experience>::iterator;
+
+    // goal is nullptr for position tasks
+    bool reuse(Iterator experience, const JointState& startPos, const JointState* goalPos,
+        double timeLimit, Solution& solution);
+    // local search from start to goal, appends states to path without start
+    bool connect(const JointState& start, const JointState& goal, double timeLimit, vector<JointState>& path,
+        Stats& stats);
+    void remember(const JointState& startPos, const Solution& solution);
+    Solution toSolution(const vector<JointState>& path) const;
+
+    ManipulatorPlanner* _planner;
+    size_t _capacity;
+    size_t _hits = 0;
+    std::list<Experience> _experiences; // the most recently used first
+};
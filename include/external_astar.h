@@ -0,0 +1,33 @@
+#pragma once
+
+#include "astar.h"
+
+#include <string>
+
+namespace astar
+{
+
+struct ExternalMemoryConfig
+{
+    std::string directory = "/tmp"; // local directory for temporary files
+    size_t memoryNodes = 1 << 20; // the maximum number of nodes which are kept in memory
+    size_t partitions = 64; // the number of files of closed list
+};
+
+/*
+External-memory A* with delayed duplicate detection.
+Open list is split into buckets by f and g values and closed list is split into
+partitions by hash of state. Both are stored in files in config.directory,
+bucket is read in portions of config.memoryNodes nodes, duplicates are removed
+by merging of sorted portion with sorted partitions of closed list.
+It is slower than astar(), but memory does not grow with the size of search.
+*/
+Solution externalAstar(
+    const JointState& startPos,
+    IAstarChecker& checker,
+    double weight,
+    const SearchControl& control,
+    const ExternalMemoryConfig& config = ExternalMemoryConfig()
+);
+
+} // namespace astar
@@ -1,12 +1,15 @@
 #pragma once
 
 #include <cmath>
+#include <stddef.h>
 
 const int g_units = 128; // the number of planner units from [0, pi]
 const double g_eps = (M_PI / g_units); // length of 1 planner unit
 const int g_unitSize = 8; // the number of world units in planner unit;
 const int g_worldUnits = g_units * g_unitSize;
 const double g_worldEps = (M_PI / g_worldUnits);
+const size_t g_maxDof = 8; // the maximum number of joints for fixed-size storages
+const double g_goalRadius = 0.05; // end-effector must be closer to goal point in position tasks
 
 using CostType = float;
 
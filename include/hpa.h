@@ -0,0 +1,74 @@
+#pragma once
+
+#include "lattice.h"
+#include "solution.h"
+
+#include <memory>
+#include <unordered_map>
+
+/*
+Hierarchical abstraction of lattice for HPA* planning.
+Lattice is split into blocks with side blockSize. Every connected piece of border
+between two neighbouring blocks gives one entrance (pair of abstract nodes),
+and costs of paths between entrances inside every block are precomputed.
+Query searches small abstract graph and refines only edges of found path.
+Found paths are not guaranteed to be optimal.
+*/
+class HierarchicalGraph
+{
+public:
+    // builds abstraction, threads = 0 means the number of hardware threads
+    HierarchicalGraph(std::shared_ptr<const Lattice> lattice, size_t blockSize = 16, size_t threads = 0);
+    // loads abstraction which was saved by save()
+    HierarchicalGraph(std::shared_ptr<const Lattice> lattice, const std::string& filename, uint64_t hash);
+
+    void save(const std::string& filename, uint64_t hash) const;
+
+    // primitiveActions must be in the same order as actions of lattice
+    Solution plan(const JointState& startPos, const JointState& goalPos,
+        const vector<Action>& primitiveActions, const Action& zeroAction) const;
+
+    size_t blockSize() const;
+    size_t nodes() const;
+    size_t edges() const;
+
+private:
+    struct Edge
+    {
+        uint32_t to;
+        uint32_t cost;
+        int32_t action; // action of lattice for edge between blocks, -1 for edge inside block
+    };
+
+    // result of breadth-first search inside one block
+    struct BlockTree
+    {
+        vector<int> dist; // by local index in block, -1 if unreachable
+        vector<int8_t> action; // action which leads to state in tree
+    };
+
+    size_t block(size_t id) const;
+    size_t local(size_t id) const;
+    // reverse search finds paths to source instead of paths from source
+    BlockTree searchBlock(size_t source, bool reverse) const;
+    // ids of actions from source of forward tree to target
+    vector<size_t> pathTo(const BlockTree& tree, size_t target) const;
+    // ids of actions from state to source of reverse tree
+    vector<size_t> pathFrom(const BlockTree& tree, size_t state) const;
+
+    void addEntrances();
+    void addInnerEdges(size_t threads);
+
+    std::shared_ptr<const Lattice> _lattice;
+    size_t _blockSize;
+    size_t _blocksInRow;
+    size_t _blockVolume;
+
+    vector<size_t> _nodes; // lattice ids of abstract nodes
+    std::unordered_map<size_t, uint32_t> _nodeOf;
+    vector<vector<Edge>> _edges;
+    vector<vector<uint32_t>> _blockNodes; // abstract nodes of every block
+};
+
+// loads lattice and abstraction saved next to model file
+std::shared_ptr<HierarchicalGraph> loadHierarchicalGraph(const ManipulatorPlanner& planner, const std::string& modelFilename);
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "planner.h"
+#include "smoother.h"
+#include "experience.h"
 #include "logger.h"
 #include "taskset.h"
 
@@ -22,6 +24,11 @@ struct Config
     std::string runtimeFilename;
     std::string CSpacePath;
     bool displayMotion = false;
+    bool smoothPath = false; // shortcut found paths before execution
+    int alg = ALG_ASTAR; // ALG_HPA, ALG_CH, ALG_CPD, ALG_ROADMAP and ALG_RSR need data precomputed by ./precompute
+    bool useComponents = false; // load components of free space precomputed by ./precompute
+    bool useLinkTable = false; // load collision tables of the first links precomputed by ./precompute
+    std::string experienceFilename = ""; // reuse paths of solved tasks with ALG_ASTAR and store them in this file
 };
 
 struct ModelState
@@ -76,10 +83,13 @@ private:
     GLFWwindow* _window;
 
     ManipulatorPlanner* _planner;
+    PathSmoother* _smoother = nullptr; // created in setUp only for smoothPath
+    ExperienceCache* _experience = nullptr;
     Logger* _logger;
     TaskSet* _taskset;
 
     size_t _dof;
+    std::string _modelFilename;
 
     bool _shouldClose = false;
 
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "joint_state.h"
+
+#include <stdint.h>
+
+/*
+Kernels over joints which are stored inline in array of g_maxDof values
+(8 int16 values fill one SSE register). Values after the last joint must be zero.
+Implementation is chosen once by features of cpu: AVX2, SSE4.1 or scalar code.
+*/
+struct JointKernels
+{
+    const char* name;
+    // out[k] = state + actions[k], cyclic joint is normalized, strides are in bytes,
+    // |actions[k][0]| <= 2 * g_units, returns bit mask of results in limits, count <= 32
+    uint32_t (*addBatch)(const JointValue* state, const JointValue* actions, size_t actionStride,
+        size_t count, JointValue* out, size_t outStride, const JointLimits& limits);
+    bool (*inLimits)(const JointValue* joints, const JointLimits& limits);
+    // manhattan distance, cyclic joint may go around the border
+    int (*manhattan)(const JointValue* joints1, const JointValue* joints2, const JointLimits& limits);
+};
+
+// the best kernels for this cpu
+const JointKernels& jointKernels();
+// all kernels which this cpu supports, scalar kernels are the first
+vector<const JointKernels*> supportedJointKernels();
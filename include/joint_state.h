@@ -1,14 +1,47 @@
 #pragma once
 
 #include "global_defs.h"
+#include "random.h"
 
 #include <vector>
+#include <cstdint>
 #include <stddef.h>
 #include <initializer_list>
 #include <cmath>
 
 using std::vector;
 
+// joint values are in [-g_units, g_units) and steps are at most 2 * g_units
+using JointValue = int16_t;
+
+/*
+Limits and discretisation of every joint. Joint i takes values from [low[i], high[i]],
+primitive actions move it by step[i] units. Only joint 0 may be cyclic: then period[0]
+is 2 * g_units, its limits are [-g_units, g_units) and it wraps around the border.
+Values after the last joint are zero, so they are always correct.
+*/
+struct JointLimits
+{
+    // the whole range [-g_units, g_units) for every joint, joint 0 is cyclic, step is 1
+    JointLimits();
+
+    alignas(16) JointValue low[g_maxDof];
+    alignas(16) JointValue high[g_maxDof];
+    alignas(16) JointValue period[g_maxDof];
+    JointValue step[g_maxDof];
+};
+
+// limits which are used when planner is not given
+const JointLimits& defaultJointLimits();
+
+/*
+Joints of Action and JointState are stored inline in array of g_maxDof values,
+so both classes are trivially copyable and never allocate memory.
+Values after the last joint are always zero, so loops over joints run over
+the whole array: they have constant trip count and are vectorised for every dof.
+*/
+class JointState;
+
 class Action
 {
 public:
@@ -17,11 +50,18 @@ public:
 
     size_t dof() const;
     int operator[](size_t i) const;
-    int& operator[](size_t i);
+    JointValue& operator[](size_t i);
     int abs() const;
+    // all g_maxDof values for kernels over joints
+    const JointValue* data() const;
 
 private:
-    vector<int> _joints;
+    friend class JointState;
+    friend int manhattanDistance(const Action& action1, const Action& action2);
+    friend uint32_t appliedBatch(const JointState& state, const Action* actions, size_t count, JointState* successors,
+        const JointLimits& limits);
+
+    JointValue _joints[g_maxDof] = {};
     size_t _dof;
 };
 
@@ -32,13 +72,15 @@ public:
     JointState(std::initializer_list<int> list);
 
     int operator[](size_t i) const;
-    int& operator[](size_t i);
+    JointValue& operator[](size_t i);
+    // all g_maxDof values for kernels over joints
+    const JointValue* data() const;
 
-    // TODO forbid to use temporaty action object
+    // keeps pointer to action for lastAction(), so action must outlive the state and its copies
     JointState& apply(const Action& action);
     JointState applied(const Action& action) const;
-
-    JointState& operator=(const JointState& other);
+    // copy without pointer to the last action, for states which outlive the action
+    JointState withoutLastAction() const;
 
     friend bool operator<(const JointState& state1, const JointState& state2);
     friend bool operator>(const JointState& state1, const JointState& state2);
@@ -46,6 +88,10 @@ public:
     friend bool operator>=(const JointState& state1, const JointState& state2);
     friend bool operator==(const JointState& state1, const JointState& state2);
     friend bool operator!=(const JointState& state1, const JointState& state2);
+    friend int manhattanDistance(const JointState& state1, const JointState& state2);
+    friend uint32_t appliedBatch(const JointState& state, const Action* actions, size_t count, JointState* successors,
+        const JointLimits& limits);
+    friend int manhattanDistance(const JointState& state1, const JointState& state2, const JointLimits& limits);
 
     // returns angle of i-th joint in radians [-pi, pi)
     double rad(size_t i) const;
@@ -60,6 +106,12 @@ public:
     int abs() const;
 
     bool isCorrect() const;
+    bool isCorrect(const JointLimits& limits) const;
+
+    // packed key, joint i takes bits [8 * i, 8 * i + 8), joint 0 is normalized inside,
+    // keys of correct states with equal dof are equal only for equal states
+    uint64_t toKey() const;
+    static JointState fromKey(uint64_t key, size_t dof);
 
     bool hasCacheXY() const;
     double cacheX() const;
@@ -69,7 +121,7 @@ public:
 private:
     void normalize();
 
-    vector<int> _joints;
+    JointValue _joints[g_maxDof] = {};
     size_t _dof;
     const Action* _lastAction = nullptr;
 
@@ -79,8 +131,49 @@ private:
 };
 
 int manhattanDistance(const JointState& state1, const JointState& state2);
+// joint 0 goes around the border only if it is cyclic in limits
+int manhattanDistance(const JointState& state1, const JointState& state2, const JointLimits& limits);
 int manhattanDistance(const Action& action1, const Action& action2);
 
 CostType manhattanHeuristic(const JointState& state1, const JointState& state2);
 
-JointState randomState(size_t dof, int units = g_units);
+// successors[k] = state.applied(actions[k]) for all k < count <= 32, |actions[k][0]| <= 2 * g_units,
+// returns bit mask of successors in limits (non-cyclic joint 0 does not go around the border),
+// all successors are built by one SIMD kernel call
+uint32_t appliedBatch(const JointState& state, const Action* actions, size_t count, JointState* successors,
+    const JointLimits& limits = defaultJointLimits());
+
+// returns action which moves start to goal by shortest way (joint 0 is cyclic)
+Action difference(const JointState& start, const JointState& goal);
+// splits straight segment start -> goal in joint space into steps,
+// every step moves each joint by -1, 0 or 1 unit
+vector<Action> lineActions(const JointState& start, const JointState& goal);
+
+// uniform random state in limits, joint i takes values which are multiples of step[i],
+// so every two random states are reachable from each other by primitive actions
+JointState randomState(Random& random, size_t dof, const JointLimits& limits = defaultJointLimits());
+// fills states[0..count) by random states, equal to count calls of randomState
+void randomStates(Random& random, size_t dof, size_t count, JointState* states,
+    const JointLimits& limits = defaultJointLimits());
+
+// bits of one joint in key of state
+const size_t g_keyBits = 8;
+static_assert(2 * g_units <= (1 << g_keyBits), "joint value does not fit into key");
+static_assert(g_maxDof * g_keyBits <= 64, "state does not fit into key");
+
+// splitmix64 finalizer, every bit of key changes every bit of hash
+inline uint64_t hashKey(uint64_t key)
+{
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ull;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBull;
+    return key ^ (key >> 31);
+}
+
+// hash for unordered containers with keys of states
+struct KeyHash
+{
+    size_t operator()(uint64_t key) const
+    {
+        return hashKey(key);
+    }
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "planner.h"
+
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+
+// hash of model parameters which influence collision checks and of lattice constants,
+// precomputed files are valid only for model with the same hash
+uint64_t modelHash(const mjModel* model);
+
+// filename of precomputed data which is stored next to model: model/2-dof/manipulator_5.<kind>
+std::string precomputedFilename(const std::string& modelFilename, const std::string& kind);
+
+// every file with precomputed data starts with this header
+void writePrecomputedHeader(FILE* file, const std::string& kind, uint64_t hash, size_t dof);
+// throws if file contains another kind of data or data for another model
+void readPrecomputedHeader(FILE* file, const std::string& kind, uint64_t hash, size_t dof);
+
+/*
+The whole discrete configuration space of manipulator. For every state it keeps
+mask of free primitive actions: action is free if its result is correct state
+and checkCollisionAction returns false. Lattice has (2 * g_units) ^ dof states,
+so it is suitable only for small dof (2 and 3).
+Building is done in parallel, every thread uses its own copy of planner.
+*/
+class Lattice
+{
+public:
+    Lattice(size_t dof = 2);
+
+    // threads = 0 means the number of hardware threads
+    void build(const ManipulatorPlanner& planner, size_t threads = 0);
+
+    size_t dof() const;
+    size_t size() const;
+    // the number of primitive actions, action ids are the same as in planner
+    size_t actions() const;
+    const Action& action(size_t actionId) const;
+    // id of action with opposite direction
+    size_t reverseAction(size_t actionId) const;
+
+    size_t index(const JointState& state) const;
+    JointState state(size_t id) const;
+    // returns size() if result of action is not correct state
+    size_t neighbour(size_t id, size_t actionId) const;
+
+    bool isFree(size_t id) const;
+    bool hasEdge(size_t id, size_t actionId) const;
+    uint16_t edgeMask(size_t id) const;
+
+    void save(const std::string& filename, uint64_t hash) const;
+    void load(const std::string& filename, uint64_t hash);
+
+private:
+    size_t _dof;
+    size_t _size;
+    vector<Action> _actions;
+    vector<size_t> _strides;
+    // bit i - action i is free, bit 15 - state is free
+    vector<uint16_t> _masks;
+};
@@ -1,3 +1,76 @@
+#pragma once
+
 #include "mujoco/mujoco.h"
+#include "global_defs.h"
+
+#include <vector>
+
+/*
+Forward kinematics of planar chain of hinges: joints 0..dof-1 are hinges with axes
+along world z, body of joint k is the child of body of joint k - 1 and the first body
+is attached to static body. Then pose of link k is rotation about z by the sum of
+angles of joints 0..k, so only geoms and sites of the chain are updated. Angles are
+integer numbers of g_worldEps: sums are taken modulo full turn and cos and sin are
+read from table, so kinematics has no trigonometric calls and is reproducible bit for bit.
+Chain is built once from the model, other models are not supported and collision
+checks fall back to mj_kinematics.
+*/
+class PlanarChain
+{
+public:
+    PlanarChain() = default;
+    // d is used as scratch data, kinematics of d is computed once for static geoms
+    PlanarChain(const mjModel* m, mjData* d, size_t dof);
+
+    // all collision pairs are between geoms of the chain and static geoms
+    bool supported() const;
+    // every site is on the chain or static
+    bool sitesSupported() const;
+    size_t links() const;
+    // updates geom_xpos, geom_xmat and site_xpos of the chain, angles[i] is angle of joint i
+    // in world units g_worldEps, qpos is not changed. Only links from link `from` are updated,
+    // poses of the previous links are taken from the last call, so their angles must not change
+    void kinematics(mjData* d, const int* angles, size_t from = 0) const;
+    // the least link k from [from, to) which collides with static geoms or links before k,
+    // links() if there are no such collisions. Pairs between static geoms and links before
+    // `from` are skipped, pairs between static geoms are checked only for from = 0
+    size_t collidingLink(const mjModel* m, mjData* d, size_t from, size_t to) const;
+
+private:
+    struct Link
+    {
+        int sign; // direction of axis along z
+        mjtNum anchor[3]; // from anchor of the previous joint at zero angles
+    };
+    struct Frame
+    {
+        int id;
+        size_t link;
+        mjtNum offset[3]; // from anchor of the link joint at zero angles
+        mjtNum mat[9]; // orientation at zero angles
+    };
+
+    struct Pose
+    {
+        mjtNum anchor[3]; // anchor of the link joint
+        int angle; // the sum of angles of joints up to the link
+    };
+
+    bool _supported = false;
+    bool _sitesSupported = false;
+    std::vector<Link> _links;
+    std::vector<Frame> _geoms; // sorted by links
+    std::vector<Frame> _sites; // sorted by links
+    // the first geom, site and pair of every link and the end
+    std::vector<size_t> _geomBegin;
+    std::vector<size_t> _siteBegin;
+    std::vector<size_t> _pairBegin;
+    std::vector<int> _pairs; // collision pairs sorted by the last link of their geoms
+    mutable std::vector<Pose> _poses; // poses of links from the last kinematics
+};
 
 bool mj_light_collision(mjModel* m, mjData* d);
+// kinematics must be computed before
+bool mj_light_collidePairs(const mjModel* m, mjData* d);
+// g2 < 0 means that g1 is a number of collision pair, kinematics must be computed before
+bool mj_light_collideGeoms(const mjModel* m, mjData* d, int g1, int g2);
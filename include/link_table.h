@@ -0,0 +1,42 @@
+#pragma once
+
+#include "planner.h"
+
+#include <memory>
+
+/*
+Bit-packed collisions of the first links of planar chain at lattice states.
+Link k of the chain collides with static geoms and links before it depending only
+on joints 0..k, so its table has one bit for every value of these joints
+((2 * g_units)^(k + 1) bits). Planner answers collision pairs of tabled links by
+lookups and computes geometry only for deeper links. Sub-steps between lattice
+states are not in tables, they are always checked by geometry.
+Tables are limited to 3 links: the third one takes 2 MB, the fourth would take 512 MB.
+*/
+class LinkCollisionTable
+{
+public:
+    static constexpr size_t maxLinks = 3;
+
+    // builds tables of links 0..links-1 in parallel, threads = 0 means the number of hardware threads
+    // planner must have supported planar chain, links <= min(dof, maxLinks)
+    LinkCollisionTable(const ManipulatorPlanner& planner, size_t links = maxLinks, size_t threads = 0);
+    // loads tables which were saved by save()
+    LinkCollisionTable(size_t dof, const std::string& filename, uint64_t hash);
+
+    void save(const std::string& filename, uint64_t hash) const;
+
+    size_t dof() const;
+    size_t links() const;
+    // the least link k from [from, to) which collides with static geoms or links before k
+    // at lattice state, dof() if there are no such collisions, to <= links()
+    size_t collidingLink(const JointState& state, size_t from, size_t to) const;
+
+private:
+    size_t _dof;
+    vector<vector<uint64_t>> _bits; // by links, bit of state is index of joints 0..k
+};
+
+// loads tables saved next to model file
+std::shared_ptr<LinkCollisionTable> loadLinkCollisionTable(const ManipulatorPlanner& planner,
+    const std::string& modelFilename);
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "planner.h"
+
+/*
+Space-time reservation table of workspace. The plane is split into square
+cells, for every time step the table keeps bitset of cells which are covered
+by links of arms planned before. Links are rasterised with margin of half of
+cell diagonal, so free cells guarantee that arms do not intersect.
+*/
+class ReservationTable
+{
+public:
+    // extent - half of side of square around origin which is covered by cells
+    ReservationTable(double extent = 3.0, double cellSize = 0.05);
+
+    // cells which are covered by geoms (cylinders) in the current kinematics of data
+    vector<uint32_t> cells(const mjModel* model, const mjData* data, const vector<int>& geoms) const;
+
+    void reserve(size_t time, const vector<uint32_t>& cells);
+    // cells are reserved from time forever, it is used for arms which reached their goals
+    void reserveFrom(size_t time, const vector<uint32_t>& cells);
+    bool isFree(size_t time, const vector<uint32_t>& cells) const;
+
+    // the table does not change after this time
+    size_t horizon() const;
+
+private:
+    typedef vector<uint64_t> Bitset;
+
+    bool intersects(const Bitset& bitset, const vector<uint32_t>& cells) const;
+    void add(Bitset& bitset, const vector<uint32_t>& cells) const;
+
+    double _extent;
+    double _cellSize;
+    size_t _side; // the number of cells on side of square
+    vector<Bitset> _steps;
+    vector<std::pair<size_t, Bitset>> _final;
+};
+
+struct MultiArmSolution
+{
+    // actions with equal index are made by arms at the same time,
+    // zero action means that arm waits, all solutions have equal size
+    vector<Solution> arms;
+    Stats stats;
+    bool coupled = false; // found by search over joints of all arms
+};
+
+/*
+Planner for several arms in one model. Joints of arm k follow joints of arm k - 1
+in qpos, collision pairs of model are split into pairs of every arm with obstacles
+and pairs between arms. Arms are planned one by one by space-time A* (action or
+wait takes one time step), paths of planned arms are put to reservation table,
+so collisions between arms are checked by lookups instead of mujoco.
+If arm can not find path, it gets the highest priority and arms are planned again.
+When all orders fail, A* over joints of all arms is run, in this search cyclic joints
+of arms except the first one do not cross the border of [-units, units).
+*/
+class MultiArmPlanner
+{
+public:
+    MultiArmPlanner(const vector<size_t>& dofs, mjModel* model);
+    MultiArmPlanner(const MultiArmPlanner& other) = delete;
+    MultiArmPlanner& operator=(const MultiArmPlanner& other) = delete;
+    ~MultiArmPlanner();
+
+    MultiArmSolution plan(const vector<JointState>& starts, const vector<JointState>& goals,
+        const astar::SearchControl& control);
+
+    // exact check of all collision pairs of model
+    bool checkCollision(const vector<JointState>& states) const;
+
+    size_t arms() const;
+
+    double cellSize = 0.05;
+    bool useCoupledFallback = true;
+
+private:
+    // sets joints of arm and computes kinematics
+    void setArm(size_t arm, const JointState& state) const;
+    // collisions of arm with obstacles and itself
+    bool checkArmCollision(size_t arm, const JointState& state) const;
+    vector<uint32_t> armCells(size_t arm, const JointState& state, const ReservationTable& table) const;
+
+    // space-time A*, table keeps arms with higher priority
+    bool planArm(size_t arm, const JointState& start, const JointState& goal, const ReservationTable& table,
+        const astar::SearchControl& control, Solution& solution, Stats& stats) const;
+    void reserve(size_t arm, const JointState& start, const Solution& path, ReservationTable& table) const;
+    MultiArmSolution coupledPlanning(const vector<JointState>& starts, const vector<JointState>& goals,
+        const astar::SearchControl& control);
+
+    vector<size_t> _dofs;
+    vector<size_t> _offsets; // the first joint of every arm in qpos
+    vector<vector<int>> _geoms; // links of every arm
+    vector<vector<int>> _pairs; // collision pairs of every arm with obstacles and itself
+    double _extent;
+
+    mjModel* _model;
+    mutable mjData* _data;
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "planner.h"
+
+/*
+Signed distance field of obstacles in the plane of manipulator, stored as grid
+of square cells. Obstacles are geoms of collision pairs which are not links
+of manipulator: boxes are cut by the plane as rectangles, spheres and
+cylinders standing on the plane as circles, other geoms by bounding circles.
+*/
+class DistanceField
+{
+public:
+    // extent - half of side of square around origin which is covered by grid
+    DistanceField(const mjModel* model, size_t dof, double extent, size_t resolution = 256);
+
+    // distance from point to the nearest obstacle, negative inside of obstacle,
+    // bilinear interpolation between cells, points out of grid are clamped
+    double distance(double x, double y) const;
+    // exact distance without grid
+    double exactDistance(double x, double y) const;
+
+private:
+    struct Shape
+    {
+        int type; // mjGEOM_BOX for rectangles, mjGEOM_SPHERE for circles
+        double x, y;
+        double axisX, axisY; // local x axis of rectangle
+        double halfX, halfY; // radius for circles
+    };
+
+    vector<Shape> _shapes;
+    double _extent;
+    double _cell;
+    size_t _resolution;
+    vector<float> _distances; // (resolution + 1)^2 values in corners of cells
+};
+
+/*
+CHOMP-like trajectory optimiser. Trajectory of waypoints with continuous joint
+values starts from a straight line in joint space and is moved by covariant
+gradient steps of smoothness cost (sum of squared differences of neighbour
+waypoints) and obstacle cost of points along links in the distance field.
+The result is rounded to lattice and every world unit of it is checked by
+checkCollisionAction, so returned path is valid as paths of other algorithms.
+If straight line can not be repaired, path of weighted A* is used as the seed.
+*/
+class TrajectoryOptimizer
+{
+public:
+    TrajectoryOptimizer(ManipulatorPlanner& planner);
+    TrajectoryOptimizer(const TrajectoryOptimizer& other) = delete;
+    TrajectoryOptimizer& operator=(const TrajectoryOptimizer& other) = delete;
+    ~TrajectoryOptimizer();
+
+    Solution plan(const JointState& startPos, const JointState& goalPos, const astar::SearchControl& control);
+
+    size_t maxIterations = 200;
+    // the maximum distance between neighbour waypoints in planner units
+    double waypointDistance = 2;
+    double obstacleWeight = 2000;
+    // links closer than margin to obstacles (in meters) are pushed away
+    double margin = 0.1;
+    // step of gradient descent, smaller steps are more stable
+    double learningRate = 0.05;
+    // the number of points on every link where obstacle cost is computed
+    size_t linkPoints = 6;
+    // rounded trajectory is checked on lattice every validationPeriod iterations
+    size_t validationPeriod = 10;
+    // optimisation stops when obstacle cost decreases slower during validationPeriod
+    double stallRatio = 0.95;
+    bool useAstarSeed = true;
+    double astarWeight = 5;
+
+private:
+    // waypoints in planner units, joint 0 is unwrapped, start and goal are included
+    typedef vector<vector<double>> Trajectory;
+
+    // longWay - joint 0 turns in the direction where distance to goal is longer
+    Trajectory lineSeed(const JointState& startPos, const JointState& goalPos, bool longWay) const;
+    Trajectory pathSeed(const JointState& startPos, const Solution& path) const;
+    // places waypoints evenly by the maximum move of joint, not farther than waypointDistance
+    void resample(Trajectory& trajectory) const;
+    // returns true and fills solution when trajectory becomes valid on lattice
+    bool optimize(Trajectory& trajectory, const JointState& startPos, const JointState& goalPos,
+        const astar::SearchControl& control, Solution& solution);
+    // penalty of points of links which are closer than margin to obstacles
+    double obstacleCost(const vector<double>& waypoint) const;
+    // rounds trajectory to lattice, returns false if some step collides
+    bool toSolution(const Trajectory& trajectory, const JointState& startPos, const JointState& goalPos,
+        Solution& solution) const;
+
+    ManipulatorPlanner* _planner;
+    mjData* _data; // own data for kinematics
+    DistanceField _field;
+};
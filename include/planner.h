@@ -2,26 +2,70 @@
 
 #include "joint_state.h"
 #include "astar.h"
+#include "external_astar.h"
 #include "solution.h"
 #include "utils.h"
+#include "light_mujoco.h"
 #include <mujoco/mujoco.h>
 
+#include <future>
+#include <memory>
+
+class HierarchicalGraph;
+class ContractionHierarchy;
+class CompressedPathDatabase;
+class ComponentMap;
+class Roadmap;
+class SymmetryReduction;
+class LinkCollisionTable;
+
 enum Algorithm
 {
     ALG_LINEAR,
     ALG_ASTAR,
+    ALG_ASTAR_EXTERNAL, // A* which keeps open and closed lists in files
+    ALG_HPA, // hierarchical planning over precomputed abstraction, see hpa.h
+    ALG_CH, // optimal queries over precomputed contraction hierarchy, see ch.h
+    ALG_CPD, // walk by precomputed table of first actions, see cpd.h
+    ALG_ROADMAP, // search over precomputed roadmap of free states, see roadmap.h
+    ALG_RRT_CONNECT, // sampling-based planner for many joints, see rrt.h
+    ALG_OPTIMIZE, // gradient optimisation of trajectory in obstacle distance field, see optimizer.h
+    ALG_THETA, // any-angle search with straight segments in joint space, see theta.h
+    ALG_RSR, // optimal search over lattice reduced by empty boxes, see rsr.h
     ALG_MAX,
 };
 
+// true for algorithms which plan only to goal state, not to position of end-effector
+bool needsGoalState(int alg);
+
 class ManipulatorPlanner : public Profiler
 {
 public:
     ManipulatorPlanner(size_t dof, mjModel* model = nullptr, mjData* data = nullptr);
+    // copy shares model with other but has its own data for collision checks,
+    // so copies can be used in different threads
+    ManipulatorPlanner(const ManipulatorPlanner& other);
+    ManipulatorPlanner& operator=(const ManipulatorPlanner& other) = delete;
+    ~ManipulatorPlanner();
 
     size_t dof() const;
+    // actions[i] moves joint i by +step, actions[i + dof] moves joint i by -step
+    const vector<Action>& primitiveActions() const;
+    const mjModel* model() const;
+
+    // limits of joints are read from jnt_range of limited joints of model (limited joint 0
+    // is not cyclic), steps of joints from numeric field "joint_steps" of model (1 by default)
+    const JointLimits& limits() const;
+    bool isCorrect(const JointState& state) const;
+    // result of action is in limits and limited joint 0 does not go around the border
+    bool isCorrect(const JointState& state, const Action& action) const;
 
     bool checkCollision(const JointState& position) const;
-    bool checkCollisionAction(const JointState& start, const Action& action) const;
+    // jump - step of collision sweep in world units, 1 means every world unit is checked
+    bool checkCollisionAction(const JointState& start, const Action& action, size_t jump = g_unitSize) const;
+    // adds step which may move several joints to solution, step is split by primitive actions
+    // if their states are free, otherwise it is added as it is
+    void addStep(Solution& solution, const JointState& state, const Action& step) const;
 
     // return C-Space as strings where @ an obstacle, . - is not
     // only for _dof = 2 now
@@ -29,45 +73,117 @@ public:
     vector<string> manipulatorPath(Solution s, const JointState& startPos);
 
     // timeLimit - is a maximum time in *seconds*, after that planner will give up
-    Solution planActions(const JointState& startPos, const JointState& goalPos, int alg = ALG_MAX - 1,
+    Solution planActions(const JointState& startPos, const JointState& goalPos, int alg = ALG_ASTAR,
         double timeLimit = 1.0, double w = 1.0);
     // plan path to move end-effector to (doubleX, doubleY) point
     // timeLimit - is a maximum time in *seconds*, after that planner will give up
     Solution planActions(const JointState& startPos, double goalX, double goalY, int alg = ALG_ASTAR,
         double timeLimit = 1.0, double w = 1.0);
+    // control - wall-clock deadline, cancellation token and progress callback
+    Solution planActions(const JointState& startPos, const JointState& goalPos, int alg,
+        const astar::SearchControl& control, double w = 1.0);
+    Solution planActions(const JointState& startPos, double goalX, double goalY, int alg,
+        const astar::SearchControl& control, double w = 1.0);
+
+    // plan in another thread, the result is available through future
+    // planner uses its own data for collision checks, so only one request
+    // may be planned by one planner at the same time (use copies of planner for more)
+    std::future<Solution> planAsync(const JointState& startPos, const JointState& goalPos, int alg,
+        const astar::SearchControl& control, double w = 1.0);
+    std::future<Solution> planAsync(const JointState& startPos, double goalX, double goalY, int alg,
+        const astar::SearchControl& control, double w = 1.0);
 
     // this method used that edges of model are cylinders
     // and that manipulator has geom numbers 1 .. _dof inclusively
-    // calculate length only 1 time
+    // length is calculated once in constructor
     double modelLength() const;
-    // calculate answer only 1 time
     double maxActionLength() const;
     // return coords of site by state of joints
     std::pair<double, double> sitePosition(const JointState& state) const;
 
+    // directory and memory limit for ALG_ASTAR_EXTERNAL
+    void setExternalMemoryConfig(const astar::ExternalMemoryConfig& config);
+    // precomputed abstraction for ALG_HPA
+    void setHierarchicalGraph(std::shared_ptr<const HierarchicalGraph> graph);
+    // precomputed hierarchy for ALG_CH
+    void setContractionHierarchy(std::shared_ptr<const ContractionHierarchy> hierarchy);
+    // precomputed database for ALG_CPD
+    void setPathDatabase(std::shared_ptr<const CompressedPathDatabase> database);
+    // precomputed components of free space, with them planActions of every algorithm
+    // returns PATH_NOT_EXISTS without search for start and goal in different components
+    void setComponentMap(std::shared_ptr<const ComponentMap> components);
+    // precomputed roadmap for ALG_ROADMAP
+    void setRoadmap(std::shared_ptr<const Roadmap> roadmap);
+    // precomputed boxes for ALG_RSR
+    void setSymmetryReduction(std::shared_ptr<const SymmetryReduction> reduction);
+    // precomputed collisions of the first links, used by collision checks of planar chains
+    void setLinkCollisionTable(std::shared_ptr<const LinkCollisionTable> table);
+
     const int units = g_units;
     const double eps = g_eps;
 
 private:
+    void initJointLimits();
     void initPrimitiveActions();
+    void initModelLength();
+    // native kinematics of planar arm for collision checks, mj_kinematics for other models
+    void initKinematics();
+    // goal may be reached from start by steps of joints
+    bool isReachableByStep(const JointState& startPos, const JointState& goalPos) const;
+    // chooses instantiations of kernels for dof of planner
+    void initDofKernels();
+
+    // kernels with constant number of joints Dof, Dof = 0 is generic code for any dof
+    template <size_t Dof>
+    void setPosition(const JointState& state) const;
+    template <size_t Dof>
+    bool checkCollisionActionDof(const JointState& start, const Action& action, size_t jump) const;
 
     Solution linearPlanning(const JointState& startPos, const JointState& goalPos);
 
+    // alg is ALG_ASTAR or ALG_ASTAR_EXTERNAL
     Solution astarPlanning(
         const JointState& startPos, const JointState& goalPos,
-        float weight, double timeLimit
+        float weight, const astar::SearchControl& control, int alg
     );
     Solution astarPlanning(
         const JointState& startPos, double goalX, double goalY,
-        float weight, double timeLimit
+        float weight, const astar::SearchControl& control, int alg
+    );
+    Solution search(
+        const JointState& startPos, astar::IAstarChecker& checker,
+        float weight, const astar::SearchControl& control, int alg
     );
 
     vector<Action> _primitiveActions;
     Action _zeroAction;
     size_t _dof;
+    JointLimits _limits;
+    void (ManipulatorPlanner::*_setPosition)(const JointState& state) const = nullptr;
+    bool (ManipulatorPlanner::*_checkCollisionAction)(const JointState& start, const Action& action, size_t jump) const = nullptr;
+    double _modelLength = 0;
+    double _maxActionLength = 0;
+    PlanarChain _chain;
+    // state whose link poses are in _data for incremental checks of its successors
+    mutable JointState _context;
+    mutable bool _hasContext = false;
+    mutable size_t _contextChecked = 0; // collisions of links before it are checked at context state
+    mutable size_t _contextCollision = 0; // the least colliding link among checked ones
+    mutable size_t _contextMoved = 0; // links from it are moved from context poses
 
     mutable mjModel* _model; // model for collision checks
     mutable mjData* _data; // data for collision checks and calculations
+    bool _ownsData = false;
+
+    astar::ExternalMemoryConfig _externalConfig;
+    std::shared_ptr<const HierarchicalGraph> _hierarchicalGraph;
+    std::shared_ptr<const ContractionHierarchy> _contractionHierarchy;
+    std::shared_ptr<const CompressedPathDatabase> _pathDatabase;
+    std::shared_ptr<const ComponentMap> _componentMap;
+    std::shared_ptr<const Roadmap> _roadmap;
+    std::shared_ptr<const SymmetryReduction> _symmetryReduction;
+    std::shared_ptr<const LinkCollisionTable> _linkTable;
+    size_t _tabledLinks = 0; // links whose collisions are taken from _linkTable
 
     class AstarChecker : public astar::IAstarChecker
     {
@@ -80,6 +196,7 @@ private:
         const std::vector<Action>& getActions() override;
         const Action& getZeroAction() override;
         CostType heuristic(const JointState& state) override;
+        const JointLimits& getLimits() override;
     protected:
         ManipulatorPlanner* _planner;
         const JointState& _goal;
@@ -96,6 +213,7 @@ private:
         const std::vector<Action>& getActions() override;
         const Action& getZeroAction() override;
         CostType heuristic(const JointState& state) override;
+        const JointLimits& getLimits() override;
     protected:
         ManipulatorPlanner* _planner;
         double _goalX;
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "planner.h"
+
+#include <memory>
+
+struct PlannerConfig
+{
+    int alg = ALG_ASTAR;
+    double w = 1.0;
+};
+
+// cost of solution found with config is at most bound * optimal cost
+double suboptimalityBound(const PlannerConfig& config);
+
+/*
+Portfolio planner runs several configurations of planner at the same time.
+Every configuration is planned in its own thread by its own copy of planner
+(with its own data for collision checks). Planner returns the first solution
+which satisfies required suboptimality and cancels the others.
+If there is not such solution, it returns the best one found until deadline.
+*/
+class PortfolioPlanner
+{
+public:
+    PortfolioPlanner(const ManipulatorPlanner& planner, const vector<PlannerConfig>& configs = defaultConfigs());
+
+    // weighted A* with w = 1.5, 3 and 10
+    static vector<PlannerConfig> defaultConfigs();
+
+    // timeLimit - is a maximum time in *seconds* of wall time
+    // suboptimality - solution with bound of suboptimality not greater than this is returned immediately
+    Solution planActions(const JointState& startPos, const JointState& goalPos,
+        double timeLimit = 1.0, double suboptimality = 1.5);
+    Solution planActions(const JointState& startPos, double goalX, double goalY,
+        double timeLimit = 1.0, double suboptimality = 1.5);
+
+    const vector<PlannerConfig>& configs() const;
+    // index of configuration which gave last solution, -1 if there was not any
+    int lastWinner() const;
+
+private:
+    using PlanFunction = std::function<Solution(ManipulatorPlanner&, const PlannerConfig&, const astar::SearchControl&)>;
+
+    Solution race(const PlanFunction& plan, double timeLimit, double suboptimality);
+
+    vector<PlannerConfig> _configs;
+    vector<std::unique_ptr<ManipulatorPlanner>> _workers;
+    int _lastWinner = -1;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+Fast deterministic generator xoshiro256**. State is seeded by splitmix64 from seed
+and number of stream, so every thread or block of work takes its own stream and
+results do not depend on the order in which streams are used.
+Generator is not shared between threads.
+Satisfies UniformRandomBitGenerator, so it works with distributions of <random>.
+*/
+class Random
+{
+public:
+    using result_type = uint64_t;
+
+    explicit Random(uint64_t seed = 12345, uint64_t stream = 0);
+
+    static constexpr uint64_t min()
+    {
+        return 0;
+    }
+    static constexpr uint64_t max()
+    {
+        return UINT64_MAX;
+    }
+
+    uint64_t operator()()
+    {
+        uint64_t result = rotl(_s[1] * 5, 7) * 9;
+        uint64_t t = _s[1] << 17;
+        _s[2] ^= _s[0];
+        _s[3] ^= _s[1];
+        _s[1] ^= _s[2];
+        _s[0] ^= _s[3];
+        _s[2] ^= t;
+        _s[3] = rotl(_s[3], 45);
+        return result;
+    }
+
+    // uniform in [low, high], bias is below (high - low) / 2^64
+    int uniform(int low, int high)
+    {
+        uint64_t range = (uint64_t)((int64_t)high - low) + 1;
+        return low + (int64_t)(((unsigned __int128)(*this)() * range) >> 64);
+    }
+    // uniform in [0, 1)
+    double uniform01()
+    {
+        return ((*this)() >> 11) * 0x1.0p-53;
+    }
+
+private:
+    static uint64_t rotl(uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    uint64_t _s[4];
+};
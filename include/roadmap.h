@@ -0,0 +1,68 @@
+#pragma once
+
+#include "planner.h"
+
+#include <memory>
+
+/*
+Roadmap of free lattice states for many queries on the same scene.
+Random free states are connected with their nearest neighbours by straight
+segments in joint space (every world unit of segment is checked on collision),
+and the graph is saved to file. Query connects start and goal to several
+closest states of roadmap by straight segment or by short A* search,
+then runs Dijkstra over roadmap. Unlike lattice, roadmap works for any dof.
+*/
+class Roadmap
+{
+public:
+    // samples - the number of free states, neighbours - the number of edges tried from every state,
+    // maxEdgeDistance - the maximum manhattan length of edge, threads = 0 means the number of hardware threads
+    Roadmap(const ManipulatorPlanner& planner, size_t samples = 2000, size_t neighbours = 10,
+        size_t maxEdgeDistance = 64, size_t threads = 0, unsigned seed = 12345);
+    // loads roadmap which was saved by save()
+    Roadmap(size_t dof, const std::string& filename, uint64_t hash);
+
+    void save(const std::string& filename, uint64_t hash) const;
+
+    // planner is used for local searches, control limits the whole query
+    Solution plan(ManipulatorPlanner& planner, const JointState& startPos, const JointState& goalPos,
+        const astar::SearchControl& control) const;
+
+    size_t nodes() const;
+    size_t edges() const;
+
+    // the number of closest roadmap states to which start and goal are connected
+    size_t connectAttempts = 8;
+    // the maximum manhattan distance and time in seconds of one local search
+    size_t maxConnectDistance = 32;
+    double localTimeLimit = 0.02;
+
+private:
+    struct Edge
+    {
+        uint32_t to;
+        uint32_t cost;
+    };
+    struct Connection
+    {
+        uint32_t node;
+        CostType cost;
+        vector<Action> actions;
+    };
+
+    // actions from start to goal by straight segment or by A*, false if both fail
+    bool connect(ManipulatorPlanner& planner, const JointState& start, const JointState& goal,
+        const astar::SearchControl& control, vector<Action>& actions, Stats& stats) const;
+    // start is in roadmap if toRoadmap, otherwise goal is
+    vector<Connection> connections(ManipulatorPlanner& planner, const JointState& state, bool toRoadmap,
+        const astar::SearchControl& control, Stats& stats) const;
+
+    size_t _dof;
+    vector<JointState> _states;
+    // edges of state s are [begin[s], begin[s + 1])
+    vector<uint32_t> _begin;
+    vector<Edge> _edges;
+};
+
+// loads roadmap saved next to model file
+std::shared_ptr<Roadmap> loadRoadmap(const ManipulatorPlanner& planner, const std::string& modelFilename);
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "planner.h"
+
+
+/*
+k-d tree over lattice states for nearest neighbour queries by manhattan distance.
+Joint 0 is cyclic, so query is repeated for copies of point shifted by full turn.
+Points are only inserted, tree is not rebalanced: random points keep it shallow.
+*/
+class KdTree
+{
+public:
+    KdTree(size_t dof = 2);
+
+    // returns id of inserted point, ids are given in order of insertion
+    size_t insert(const JointState& state);
+    // id of the nearest point, tree must not be empty
+    size_t nearest(const JointState& state) const;
+
+    size_t size() const;
+    const JointState& point(size_t id) const;
+
+private:
+    struct Node
+    {
+        int32_t left = -1;
+        int32_t right = -1;
+    };
+
+    void nearest(int32_t node, size_t depth, const vector<int>& query, size_t& best, int& bestDistance) const;
+
+    size_t _dof;
+    vector<JointState> _points;
+    vector<Node> _nodes; // by id of point
+};
+
+/*
+RRT-Connect planner. Two trees grow from start and goal to random states and
+to each other by straight segments in joint space, every world unit of segment
+is checked by checkCollisionAction. Runtime does not grow exponentially with dof
+like grid search does, but paths are not optimal. Steps of found path which move
+several joints at once are split into primitive actions where it is possible.
+*/
+class RrtConnect
+{
+public:
+    RrtConnect(const ManipulatorPlanner& planner, unsigned seed = 12345);
+
+    Solution plan(const JointState& startPos, const JointState& goalPos, const astar::SearchControl& control);
+
+    // the maximum number of planner units which joint can move in one extension
+    int stepSize = 8;
+    size_t maxIterations = 100000;
+
+private:
+    enum ExtendResult
+    {
+        TRAPPED,
+        ADVANCED,
+        REACHED,
+    };
+
+    struct Tree
+    {
+        KdTree index;
+        vector<size_t> parent;
+        vector<vector<Action>> steps; // checked steps from parent to node
+    };
+
+    ExtendResult extend(Tree& tree, const JointState& target);
+    ExtendResult connect(Tree& tree, const JointState& target);
+    // nodes from root of tree to node
+    vector<size_t> branch(const Tree& tree, size_t node) const;
+
+    const ManipulatorPlanner* _planner;
+    Random _random;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "lattice.h"
+#include "solution.h"
+
+#include <memory>
+
+/*
+Rectangular symmetry reduction of lattice. Free states are split into empty boxes
+(every state inside is free and every edge between them is free), states strictly
+inside of boxes are pruned, and every state on face of box gets macro edge to
+the opposite face. Any optimal path inside of box can be replaced by path over
+faces and macro edges of the same cost, so search over the reduced graph is
+optimal, but it does not expand many symmetric paths inside of boxes.
+Start and goal inside of box are connected to faces of their box during query.
+*/
+class SymmetryReduction
+{
+public:
+    // splits free states of lattice into boxes
+    SymmetryReduction(std::shared_ptr<const Lattice> lattice);
+    // loads boxes which were saved by save()
+    SymmetryReduction(std::shared_ptr<const Lattice> lattice, const std::string& filename, uint64_t hash);
+
+    void save(const std::string& filename, uint64_t hash) const;
+
+    // primitiveActions must be in the same order as actions of lattice
+    Solution plan(const JointState& startPos, const JointState& goalPos,
+        const vector<Action>& primitiveActions, const Action& zeroAction) const;
+
+    size_t boxes() const;
+    // the number of states which are not pruned
+    size_t keptStates() const;
+
+private:
+    // coordinates of lattice are joint values shifted by g_units
+    struct Box
+    {
+        uint8_t lo[3];
+        uint8_t hi[3];
+    };
+
+    int coord(size_t id, size_t joint) const;
+    bool isInterior(size_t id) const;
+    bool canGrow(const Box& box, size_t joint) const;
+    void assign(const Box& box, uint32_t boxId);
+    // calls f(id) for every state of box
+    template <class F>
+    void forEachState(const Box& box, F f) const;
+
+    std::shared_ptr<const Lattice> _lattice;
+    vector<size_t> _strides;
+    vector<Box> _boxes;
+    vector<uint32_t> _boxOf; // by state, noBox for obstacles
+};
+
+// loads lattice and boxes saved next to model file
+std::shared_ptr<SymmetryReduction> loadSymmetryReduction(const ManipulatorPlanner& planner, const std::string& modelFilename);
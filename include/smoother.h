@@ -0,0 +1,42 @@
+#pragma once
+
+#include "planner.h"
+#include "solution.h"
+
+#include <memory>
+
+/*
+Post-processing of found paths. Smoother tries to replace pieces of path
+by straight segments in joint space, where every step can move several joints at once.
+Candidates are checked in parallel, every thread uses its own copy of planner
+(and its own mujoco data) for collision checks.
+*/
+class PathSmoother : public Profiler
+{
+public:
+    // threads = 0 means the number of hardware threads
+    PathSmoother(const ManipulatorPlanner& planner, size_t threads = 0);
+
+    // returns solution with the same start and goal which is not longer than given one
+    // rounds - the maximum number of shortcutting iterations
+    // candidates - the number of shortcuts which are tried on every iteration
+    Solution smooth(const Solution& solution, const JointState& startPos,
+        size_t rounds = 8, size_t candidates = 256);
+
+    size_t threads() const;
+
+private:
+    struct Shortcut
+    {
+        size_t from;
+        size_t to;
+        vector<Action> actions;
+        bool valid = false;
+    };
+
+    // checks every world unit of segment
+    bool checkShortcut(const ManipulatorPlanner& planner, JointState state, const vector<Action>& actions) const;
+
+    vector<std::unique_ptr<ManipulatorPlanner>> _workers;
+    Random _random;
+};
@@ -29,6 +29,14 @@ public:
 
     Action& nextAction();
     void addAction(size_t stepId);
+    // adds action which is not necessarily primitive
+    void addAction(const Action& action);
+
+    // the number of actions in solution
+    size_t size() const;
+    const Action& getAction(size_t i) const;
+    const vector<Action>& primitiveActions() const;
+    const Action& zeroAction() const;
 
     bool goalAchieved() const;
 
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "planner.h"
+
+#include <unordered_map>
+
+/*
+Lazy Theta* over the lattice. Successor takes parent of expanded state as its
+own parent, so path consists of straight segments in joint space instead of
+staircase of primitive actions. Line of sight is checked only when state is
+expanded: every world unit of segment is checked by checkCollisionAction, and
+if it collides, the best expanded neighbour becomes parent as in A*.
+Cost of path is euclidean length in joint space, heuristic is euclidean
+distance to goal. Segments are split by lineActions into steps, which move every
+joint by at most one planner unit, and steps are added by addStep as primitive actions.
+*/
+class ThetaStar
+{
+public:
+    ThetaStar(const ManipulatorPlanner& planner);
+
+    Solution plan(const JointState& startPos, const JointState& goalPos, const astar::SearchControl& control,
+        double weight = 1.0);
+
+    // the maximum manhattan length of segment, longer segments are split
+    int maxSegment = 8;
+
+private:
+    struct Node
+    {
+        JointState state;
+        CostType g;
+        size_t parent;
+        bool closed;
+    };
+
+    // id of node with state, it is added if it is new
+    size_t node(const JointState& state);
+    bool lineOfSight(const JointState& from, const JointState& to) const;
+
+    const ManipulatorPlanner* _planner;
+    vector<Node> _nodes;
+    std::unordered_map<uint64_t, size_t, KeyHash> _ids; // by key of state
+};
+
+// euclidean distance in joint space, joint 0 is cyclic
+CostType euclideanDistance(const JointState& state1, const JointState& state2);
@@ -1,6 +1,7 @@
 #include "astar.h"
 #include "utils.h"
 
+#include <algorithm>
 #include <vector>
 
 namespace astar {
@@ -10,7 +11,7 @@ SearchNode::SearchNode(CostType g, CostType h, const JointState& state, int step
     _g = g;
     _h = h;
     _f = _g + _h;
-    _state = state;
+    _state = state.withoutLastAction();
     _stepNum = stepNum;
     _parent = parent;
 }
@@ -45,10 +46,6 @@ bool SearchNode::operator<(const SearchNode& sn)
     return f() == sn.f() ? -g() < -sn.g() : f() < sn.f();
 }
 
-bool CmpByState::operator()(SearchNode* a, SearchNode* b) const
-{
-    return a->state() < b->state();
-}
 bool CmpByPriority::operator()(SearchNode* a, SearchNode* b) const
 {
     return *a < *b;
@@ -65,11 +62,9 @@ SearchTree::~SearchTree()
         delete node;
     }
 
-    while (!_closed.empty())
+    for (auto& closed : _closed)
     {
-        SearchNode* node = *_closed.begin();
-        _closed.erase(_closed.begin());
-        delete node;
+        delete closed.second;
     }
 }
 
@@ -82,7 +77,7 @@ void SearchTree::addToOpen(SearchNode* node)
 void SearchTree::addToClosed(SearchNode* node)
 {
     startProfiling();
-    _closed.insert(node);
+    _closed.emplace(node->state().toKey(), node);
     stopProfiling();
 }
 
@@ -120,11 +115,60 @@ size_t SearchTree::sizeOpen() const
 bool SearchTree::wasExpanded(SearchNode* node) const
 {
     startProfiling();
-    bool res = _closed.count(node);
+    bool res = _closed.count(node->state().toKey());
     stopProfiling();
     return res;
 }
 
+CancellationToken::CancellationToken()
+{
+    _cancelled = std::make_shared<std::atomic<bool>>(false);
+}
+
+void CancellationToken::cancel() const
+{
+    _cancelled->store(true);
+}
+bool CancellationToken::isCancelled() const
+{
+    return _cancelled->load(std::memory_order_relaxed);
+}
+
+SearchControl::SearchControl()
+{
+    deadline = Clock::time_point::max();
+}
+SearchControl::SearchControl(double timeLimit)
+{
+    deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeLimit));
+}
+
+bool SearchControl::shouldStop() const
+{
+    return token.isCancelled() || Clock::now() > deadline;
+}
+bool SearchControl::shouldStop(size_t expansions) const
+{
+    return (checkPeriod <= 1 || expansions % checkPeriod == 0) && shouldStop();
+}
+
+vector<size_t> extractPath(SearchNode* node)
+{
+    vector<size_t> actions;
+    while (node->parent() != nullptr)
+    {
+        actions.push_back(node->stepNum());
+        node = node->parent();
+    }
+    std::reverse(actions.begin(), actions.end());
+    return actions;
+}
+
+const JointLimits& IAstarChecker::getLimits()
+{
+    return defaultJointLimits();
+}
+
 vector<SearchNode*> generateSuccessors(
     SearchNode* node,
     IAstarChecker& checker,
@@ -132,23 +176,31 @@ vector<SearchNode*> generateSuccessors(
 )
 {
     vector<SearchNode*> result;
-    for (size_t i = 0; i < checker.getActions().size(); ++i)
+    const vector<Action>& actions = checker.getActions();
+    JointState successors[2 * g_maxDof];
+    // successors are built by batches, incorrect ones are filtered by mask
+    for (size_t first = 0; first < actions.size(); first += 2 * g_maxDof)
     {
-        Action action = checker.getActions()[i];
-        JointState newState = node->state().applied(action);
-        if (!checker.isCorrect(node->state(), action))
+        size_t count = std::min(actions.size() - first, 2 * g_maxDof);
+        uint32_t correct = appliedBatch(node->state(), &actions[first], count, successors, checker.getLimits());
+        for (size_t k = 0; k < count; ++k)
         {
-            continue;
+            // new state keeps pointer to its last action, so action is reference
+            const Action& action = actions[first + k];
+            if (!(correct >> k & 1) || !checker.isCorrect(node->state(), action))
+            {
+                continue;
+            }
+            result.push_back(
+                new SearchNode(
+                    node->g() + checker.costAction(node->state(), action),
+                    checker.heuristic(successors[k]) * weight,
+                    successors[k],
+                    first + k,
+                    node
+                )
+            );
         }
-        result.push_back(
-            new SearchNode(
-                node->g() + checker.costAction(node->state(), action),
-                checker.heuristic(newState) * weight,
-                newState,
-                i,
-                node
-            )
-        );
     }
 
     return result;
@@ -160,18 +212,28 @@ Solution astar(
     double weight,
     double timeLimit
 )
+{
+    return astar(startPos, checker, weight, SearchControl(timeLimit));
+}
+
+Solution astar(
+    const JointState& startPos,
+    IAstarChecker& checker,
+    double weight,
+    const SearchControl& control
+)
 {
     Solution solution(checker.getActions(), checker.getZeroAction());
-    clock_t clockTimeLimit = timeLimit * CLOCKS_PER_SEC;
 
     // start timer
-    clock_t start = clock();
+    Clock::time_point start = Clock::now();
 
     // init search tree
     SearchTree tree;
     SearchNode* startNode = new astar::SearchNode(0, checker.heuristic(startPos) * weight, startPos);
     tree.addToOpen(startNode);
     SearchNode* currentNode = tree.extractBestNode();
+    SearchNode* incumbent = currentNode;
 
     while (currentNode != nullptr)
     {
@@ -180,12 +242,25 @@ Solution astar(
             solution.stats.pathVerdict = PATH_FOUND;
             break;
         }
-        // give up if time limit is exhausted
-        if (clock() - start > clockTimeLimit)
+        // give up if time limit is exhausted or search is cancelled
+        if (control.shouldStop(solution.stats.expansions))
         {
             solution.stats.pathVerdict = PATH_NOT_FOUND;
             break;
         }
+        if (currentNode->h() < incumbent->h())
+        {
+            incumbent = currentNode;
+        }
+        if (control.progressPeriod != 0 && control.onProgress &&
+            solution.stats.expansions % control.progressPeriod == 0)
+        {
+            SearchProgress progress;
+            progress.expansions = solution.stats.expansions;
+            progress.bestF = currentNode->f();
+            progress.incumbentPath = extractPath(incumbent);
+            control.onProgress(progress);
+        }
         // expand current node
         vector<astar::SearchNode*> successors = generateSuccessors(currentNode, checker, weight);
         for (auto successor : successors)
@@ -201,8 +276,7 @@ Solution astar(
     }
 
     // end timer
-    clock_t end = clock();
-    solution.stats.runtime = (double)(end - start) / CLOCKS_PER_SEC;
+    solution.stats.runtime = std::chrono::duration<double>(Clock::now() - start).count();
 
     if (currentNode == nullptr)
     {
@@ -211,18 +285,12 @@ Solution astar(
     else if (solution.stats.pathVerdict == PATH_FOUND)
     {
         solution.stats.pathCost = currentNode->g();
-        vector<size_t> actions;
-        while (currentNode->parent() != nullptr)
-        {
-            actions.push_back(currentNode->stepNum());
-            currentNode = currentNode->parent();
-        }
         solution.stats.pathPotentialCost = checker.heuristic(startPos);
 
         // push actions
-        for (int i = actions.size() - 1; i >= 0; --i)
+        for (size_t action : extractPath(currentNode))
         {
-            solution.addAction(actions[i]);
+            solution.addAction(action);
         }
     }
 
@@ -0,0 +1,451 @@
+#include "ch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+
+using Edge = ContractionHierarchy::Edge;
+using QueueItem = std::pair<uint32_t, uint32_t>; // key, state
+using MinQueue = std::priority_queue<QueueItem, vector<QueueItem>, std::greater<QueueItem>>;
+
+const uint32_t g_infinity = std::numeric_limits<uint32_t>::max();
+// witness search gives up after this number of settled states, then shortcut is added
+const size_t g_maxWitnessSettled = 500;
+
+// graph which is being contracted, lists contain only edges between not contracted states
+class Contractor
+{
+public:
+    Contractor(const Lattice& lattice)
+    {
+        _out.resize(lattice.size());
+        _in.resize(lattice.size());
+        _contracted.assign(lattice.size(), false);
+        _deleted.assign(lattice.size(), 0);
+        _dist.assign(lattice.size(), g_infinity);
+        forward.resize(lattice.size());
+        backward.resize(lattice.size());
+        for (size_t id = 0; id < lattice.size(); ++id)
+        {
+            for (size_t a = 0; a < lattice.actions(); ++a)
+            {
+                if (lattice.hasEdge(id, a))
+                {
+                    uint32_t next = lattice.neighbour(id, a);
+                    _out[id].push_back({next, 1, -(int32_t)a - 1});
+                    _in[next].push_back({(uint32_t)id, 1, -(int32_t)a - 1});
+                }
+            }
+        }
+    }
+
+    void contractAll()
+    {
+        MinQueue queue;
+        for (uint32_t state = 0; state < _out.size(); ++state)
+        {
+            if (!_out[state].empty() || !_in[state].empty())
+            {
+                queue.push({priority(state), state});
+            }
+        }
+        while (!queue.empty())
+        {
+            uint32_t state = queue.top().second;
+            queue.pop();
+            // lazy update of priority
+            uint32_t current = priority(state);
+            if (!queue.empty() && current > queue.top().first)
+            {
+                queue.push({current, state});
+                continue;
+            }
+            contract(state);
+        }
+    }
+
+    // upward edges of every state
+    vector<vector<Edge>> forward;
+    vector<vector<Edge>> backward;
+    size_t shortcuts = 0;
+
+private:
+    // edge difference plus the number of contracted neighbours, shifted to be positive
+    uint32_t priority(uint32_t state)
+    {
+        long long added = processState(state, false);
+        long long removed = _in[state].size() + _out[state].size();
+        return added - removed + _deleted[state] + (1 << 20);
+    }
+
+    void contract(uint32_t state)
+    {
+        processState(state, true);
+        forward[state] = _out[state];
+        backward[state] = _in[state];
+        _contracted[state] = true;
+        for (const Edge& edge : _out[state])
+        {
+            erase(_in[edge.to], state);
+            ++_deleted[edge.to];
+        }
+        for (const Edge& edge : _in[state])
+        {
+            erase(_out[edge.to], state);
+            ++_deleted[edge.to];
+        }
+    }
+
+    // returns the number of shortcuts needed to contract state
+    size_t processState(uint32_t state, bool apply)
+    {
+        size_t added = 0;
+        uint32_t maxOut = 0;
+        for (const Edge& edge : _out[state])
+        {
+            maxOut = std::max(maxOut, edge.cost);
+        }
+        for (size_t i = 0; i < _in[state].size(); ++i)
+        {
+            Edge in = _in[state][i];
+            witnessSearch(in.to, state, in.cost + maxOut);
+            for (size_t j = 0; j < _out[state].size(); ++j)
+            {
+                Edge out = _out[state][j];
+                uint32_t cost = in.cost + out.cost;
+                if (out.to == in.to || _dist[out.to] <= cost)
+                {
+                    continue;
+                }
+                ++added;
+                if (apply)
+                {
+                    addShortcut(in.to, out.to, cost, state);
+                }
+            }
+        }
+        return added;
+    }
+
+    void witnessSearch(uint32_t source, uint32_t excluded, uint32_t limit)
+    {
+        for (uint32_t state : _touched)
+        {
+            _dist[state] = g_infinity;
+        }
+        _touched.clear();
+
+        MinQueue queue;
+        _dist[source] = 0;
+        _touched.push_back(source);
+        queue.push({0, source});
+        size_t settled = 0;
+        while (!queue.empty())
+        {
+            uint32_t dist = queue.top().first;
+            uint32_t current = queue.top().second;
+            queue.pop();
+            if (dist > _dist[current])
+            {
+                continue;
+            }
+            if (dist > limit || ++settled > g_maxWitnessSettled)
+            {
+                break;
+            }
+            for (const Edge& edge : _out[current])
+            {
+                if (edge.to == excluded || dist + edge.cost >= _dist[edge.to])
+                {
+                    continue;
+                }
+                if (_dist[edge.to] == g_infinity)
+                {
+                    _touched.push_back(edge.to);
+                }
+                _dist[edge.to] = dist + edge.cost;
+                queue.push({_dist[edge.to], edge.to});
+            }
+        }
+    }
+
+    void addShortcut(uint32_t from, uint32_t to, uint32_t cost, uint32_t via)
+    {
+        for (Edge& edge : _out[from])
+        {
+            if (edge.to == to)
+            {
+                if (edge.cost > cost)
+                {
+                    edge.cost = cost;
+                    edge.via = via;
+                    for (Edge& reverse : _in[to])
+                    {
+                        if (reverse.to == from)
+                        {
+                            reverse.cost = cost;
+                            reverse.via = via;
+                        }
+                    }
+                }
+                return;
+            }
+        }
+        _out[from].push_back({to, cost, (int32_t)via});
+        _in[to].push_back({from, cost, (int32_t)via});
+        ++shortcuts;
+    }
+
+    static void erase(vector<Edge>& edges, uint32_t state)
+    {
+        edges.erase(std::remove_if(edges.begin(), edges.end(),
+            [state](const Edge& edge) { return edge.to == state; }), edges.end());
+    }
+
+    vector<vector<Edge>> _out;
+    vector<vector<Edge>> _in;
+    vector<bool> _contracted;
+    vector<uint32_t> _deleted;
+
+    vector<uint32_t> _dist; // of witness search
+    vector<uint32_t> _touched;
+};
+
+void toCompressed(const vector<vector<Edge>>& lists, vector<uint32_t>& begin, vector<Edge>& edges)
+{
+    begin.assign(1, 0);
+    edges.clear();
+    for (const vector<Edge>& list : lists)
+    {
+        edges.insert(edges.end(), list.begin(), list.end());
+        begin.push_back(edges.size());
+    }
+}
+
+} // namespace
+
+ContractionHierarchy::ContractionHierarchy(std::shared_ptr<const Lattice> lattice)
+{
+    _lattice = lattice;
+    Contractor contractor(*_lattice);
+    contractor.contractAll();
+    toCompressed(contractor.forward, _forwardBegin, _forward);
+    toCompressed(contractor.backward, _backwardBegin, _backward);
+}
+
+ContractionHierarchy::ContractionHierarchy(std::shared_ptr<const Lattice> lattice, const std::string& filename, uint64_t hash)
+{
+    _lattice = lattice;
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("ContractionHierarchy: Could not open file " + filename);
+    }
+    try
+    {
+        readPrecomputedHeader(file, "ch", hash, _lattice->dof());
+        uint32_t sizes[2];
+        bool ok = fread(sizes, sizeof(sizes), 1, file) == 1;
+        _forwardBegin.resize(_lattice->size() + 1);
+        _backwardBegin.resize(_lattice->size() + 1);
+        _forward.resize(ok ? sizes[0] : 0);
+        _backward.resize(ok ? sizes[1] : 0);
+        ok = ok && fread(_forwardBegin.data(), sizeof(uint32_t), _forwardBegin.size(), file) == _forwardBegin.size();
+        ok = ok && fread(_forward.data(), sizeof(Edge), _forward.size(), file) == _forward.size();
+        ok = ok && fread(_backwardBegin.data(), sizeof(uint32_t), _backwardBegin.size(), file) == _backwardBegin.size();
+        ok = ok && fread(_backward.data(), sizeof(Edge), _backward.size(), file) == _backward.size();
+        if (!ok)
+        {
+            throw std::runtime_error("ContractionHierarchy: file " + filename + " is too short");
+        }
+    }
+    catch (...)
+    {
+        fclose(file);
+        throw;
+    }
+    fclose(file);
+}
+
+void ContractionHierarchy::save(const std::string& filename, uint64_t hash) const
+{
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("ContractionHierarchy::save: Could not open file " + filename);
+    }
+    writePrecomputedHeader(file, "ch", hash, _lattice->dof());
+    uint32_t sizes[2] = {(uint32_t)_forward.size(), (uint32_t)_backward.size()};
+    fwrite(sizes, sizeof(sizes), 1, file);
+    fwrite(_forwardBegin.data(), sizeof(uint32_t), _forwardBegin.size(), file);
+    fwrite(_forward.data(), sizeof(Edge), _forward.size(), file);
+    fwrite(_backwardBegin.data(), sizeof(uint32_t), _backwardBegin.size(), file);
+    fwrite(_backward.data(), sizeof(Edge), _backward.size(), file);
+    fclose(file);
+}
+
+Solution ContractionHierarchy::plan(const JointState& startPos, const JointState& goalPos,
+    const vector<Action>& primitiveActions, const Action& zeroAction) const
+{
+    Solution solution(primitiveActions, zeroAction);
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    struct Label
+    {
+        uint32_t dist;
+        uint32_t parent;
+        int32_t via;
+    };
+    // search spaces are small, so hash maps are cheaper than arrays for the whole lattice
+    std::unordered_map<uint32_t, Label> labels[2];
+    MinQueue queues[2];
+    const vector<uint32_t>* begins[2] = {&_forwardBegin, &_backwardBegin};
+    const vector<Edge>* edges[2] = {&_forward, &_backward};
+
+    uint32_t start = _lattice->index(startPos);
+    uint32_t goal = _lattice->index(goalPos);
+    labels[0][start] = {0, start, 0};
+    labels[1][goal] = {0, goal, 0};
+    queues[0].push({0, start});
+    queues[1].push({0, goal});
+    uint32_t best = g_infinity;
+    uint32_t meeting = 0;
+    if (start == goal)
+    {
+        best = 0;
+        meeting = start;
+    }
+
+    size_t side = 0;
+    while (!queues[0].empty() || !queues[1].empty())
+    {
+        // all paths through not settled states are not shorter than best
+        uint32_t top0 = queues[0].empty() ? g_infinity : queues[0].top().first;
+        uint32_t top1 = queues[1].empty() ? g_infinity : queues[1].top().first;
+        if (std::min(top0, top1) >= best)
+        {
+            break;
+        }
+        side = queues[side].empty() ? 1 - side : side;
+        uint32_t dist = queues[side].top().first;
+        uint32_t current = queues[side].top().second;
+        queues[side].pop();
+        if (dist > labels[side][current].dist)
+        {
+            side = 1 - side;
+            continue;
+        }
+        ++solution.stats.expansions;
+        auto other = labels[1 - side].find(current);
+        if (other != labels[1 - side].end() && dist + other->second.dist < best)
+        {
+            best = dist + other->second.dist;
+            meeting = current;
+        }
+        for (uint32_t i = (*begins[side])[current]; i < (*begins[side])[current + 1]; ++i)
+        {
+            const Edge& edge = (*edges[side])[i];
+            auto it = labels[side].find(edge.to);
+            if (it == labels[side].end() || dist + edge.cost < it->second.dist)
+            {
+                labels[side][edge.to] = {dist + edge.cost, current, edge.via};
+                queues[side].push({dist + edge.cost, edge.to});
+            }
+        }
+        side = 1 - side;
+    }
+    solution.stats.maxTreeSize = labels[0].size() + labels[1].size();
+
+    if (best == g_infinity)
+    {
+        // search is exact, so there is no path in lattice
+        solution.stats.pathVerdict = PATH_NOT_EXISTS;
+    }
+    else
+    {
+        // edges from start to meeting state
+        vector<std::pair<uint32_t, const Label*>> up;
+        for (uint32_t state = meeting; state != start; state = labels[0][state].parent)
+        {
+            up.push_back({state, &labels[0][state]});
+        }
+        vector<size_t> actions;
+        for (auto it = up.rbegin(); it != up.rend(); ++it)
+        {
+            unpack(it->second->parent, it->first, it->second->via, actions);
+        }
+        // edges from meeting state to goal
+        for (uint32_t state = meeting; state != goal; state = labels[1][state].parent)
+        {
+            unpack(state, labels[1][state].parent, labels[1][state].via, actions);
+        }
+        for (size_t action : actions)
+        {
+            solution.addAction(action);
+        }
+        solution.stats.pathVerdict = PATH_FOUND;
+        solution.stats.pathCost = best;
+        solution.stats.pathPotentialCost = manhattanHeuristic(startPos, goalPos);
+    }
+    solution.stats.runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return solution;
+}
+
+size_t ContractionHierarchy::edges() const
+{
+    return _forward.size() + _backward.size();
+}
+size_t ContractionHierarchy::shortcuts() const
+{
+    size_t result = 0;
+    for (const Edge& edge : _forward)
+    {
+        result += edge.via >= 0;
+    }
+    for (const Edge& edge : _backward)
+    {
+        result += edge.via >= 0;
+    }
+    return result;
+}
+
+void ContractionHierarchy::unpack(uint32_t from, uint32_t to, int32_t via, vector<size_t>& actions) const
+{
+    if (via < 0)
+    {
+        actions.push_back(-via - 1);
+        return;
+    }
+    // middle state was contracted before both ends, so both halves are its upward edges
+    uint32_t middle = via;
+    unpack(from, middle, findEdge(_backwardBegin, _backward, middle, from).via, actions);
+    unpack(middle, to, findEdge(_forwardBegin, _forward, middle, to).via, actions);
+}
+
+const ContractionHierarchy::Edge& ContractionHierarchy::findEdge(const vector<uint32_t>& begin, const vector<Edge>& edges,
+    uint32_t state, uint32_t to) const
+{
+    for (uint32_t i = begin[state]; i < begin[state + 1]; ++i)
+    {
+        if (edges[i].to == to)
+        {
+            return edges[i];
+        }
+    }
+    throw std::runtime_error("ContractionHierarchy::findEdge: hierarchy is broken");
+}
+
+std::shared_ptr<ContractionHierarchy> loadContractionHierarchy(const ManipulatorPlanner& planner, const std::string& modelFilename)
+{
+    uint64_t hash = modelHash(planner.model());
+    std::shared_ptr<Lattice> lattice = std::make_shared<Lattice>(planner.dof());
+    lattice->load(precomputedFilename(modelFilename, "lattice"), hash);
+    return std::make_shared<ContractionHierarchy>(lattice, precomputedFilename(modelFilename, "ch"), hash);
+}
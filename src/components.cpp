@@ -0,0 +1,282 @@
+#include "components.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+
+// lock-free union-find, roots are the smallest states of components
+class ConcurrentUnionFind
+{
+public:
+    ConcurrentUnionFind(size_t size) : _parent(size)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            _parent[i].store(i, std::memory_order_relaxed);
+        }
+    }
+
+    uint32_t find(uint32_t x)
+    {
+        while (true)
+        {
+            uint32_t parent = _parent[x].load();
+            if (parent == x)
+            {
+                return x;
+            }
+            uint32_t grandParent = _parent[parent].load();
+            // path halving, failure means that another thread has changed it
+            _parent[x].compare_exchange_weak(parent, grandParent);
+            x = grandParent;
+        }
+    }
+
+    void unite(uint32_t x, uint32_t y)
+    {
+        while (true)
+        {
+            x = find(x);
+            y = find(y);
+            if (x == y)
+            {
+                return;
+            }
+            if (x < y)
+            {
+                std::swap(x, y);
+            }
+            // link larger root to smaller one, retry if x stopped to be root
+            uint32_t expected = x;
+            if (_parent[x].compare_exchange_strong(expected, y))
+            {
+                return;
+            }
+        }
+    }
+
+private:
+    vector<std::atomic<uint32_t>> _parent;
+};
+
+} // namespace
+
+ComponentMap::ComponentMap(const Lattice& lattice, const ManipulatorPlanner& planner, size_t threads)
+{
+    _dof = lattice.dof();
+    _size = lattice.size();
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    ConcurrentUnionFind sets(_size);
+    auto unite = [this, threads, &lattice, &sets](size_t id)
+    {
+        for (size_t i = _size * id / threads; i < _size * (id + 1) / threads; ++i)
+        {
+            // edges are symmetric, so positive actions are enough
+            for (size_t a = 0; a < _dof; ++a)
+            {
+                if (lattice.hasEdge(i, a))
+                {
+                    sets.unite(i, lattice.neighbour(i, a));
+                }
+            }
+        }
+    };
+    vector<std::thread> workers;
+    for (size_t id = 0; id < threads; ++id)
+    {
+        workers.emplace_back(unite, id);
+    }
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    // roots are the smallest states, so labels are given in one pass
+    vector<uint32_t> labels(_size, 0);
+    uint32_t count = 0;
+    for (size_t i = 0; i < _size; ++i)
+    {
+        if (lattice.isFree(i))
+        {
+            uint32_t root = sets.find(i);
+            labels[i] = root == i ? ++count : labels[root];
+        }
+    }
+
+    // bounding boxes of end-effector, every thread uses its own copy of planner
+    const float inf = std::numeric_limits<float>::infinity();
+    vector<vector<Box>> boxes(threads, vector<Box>(count, {inf, inf, -inf, -inf}));
+    auto measure = [this, threads, &lattice, &labels, &boxes](const ManipulatorPlanner* checker, size_t id)
+    {
+        for (size_t i = _size * id / threads; i < _size * (id + 1) / threads; ++i)
+        {
+            if (labels[i] == 0)
+            {
+                continue;
+            }
+            std::pair<double, double> xy = checker->sitePosition(lattice.state(i));
+            Box& box = boxes[id][labels[i] - 1];
+            box.minX = std::min(box.minX, (float)xy.first);
+            box.minY = std::min(box.minY, (float)xy.second);
+            box.maxX = std::max(box.maxX, (float)xy.first);
+            box.maxY = std::max(box.maxY, (float)xy.second);
+        }
+    };
+    vector<std::unique_ptr<ManipulatorPlanner>> checkers;
+    workers.clear();
+    for (size_t id = 0; id < threads; ++id)
+    {
+        checkers.push_back(std::make_unique<ManipulatorPlanner>(planner));
+    }
+    for (size_t id = 0; id < threads; ++id)
+    {
+        workers.emplace_back(measure, checkers[id].get(), id);
+    }
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    _boxes = boxes[0];
+    for (size_t id = 1; id < threads; ++id)
+    {
+        for (size_t c = 0; c < count; ++c)
+        {
+            _boxes[c].minX = std::min(_boxes[c].minX, boxes[id][c].minX);
+            _boxes[c].minY = std::min(_boxes[c].minY, boxes[id][c].minY);
+            _boxes[c].maxX = std::max(_boxes[c].maxX, boxes[id][c].maxX);
+            _boxes[c].maxY = std::max(_boxes[c].maxY, boxes[id][c].maxY);
+        }
+    }
+
+    pack(labels);
+}
+
+ComponentMap::ComponentMap(size_t dof, const std::string& filename, uint64_t hash)
+{
+    _dof = dof;
+    _size = 1;
+    for (size_t i = 0; i < _dof; ++i)
+    {
+        _size *= 2 * g_units;
+    }
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("ComponentMap: Could not open file " + filename);
+    }
+    try
+    {
+        readPrecomputedHeader(file, "comp", hash, _dof);
+        uint32_t header[2]; // components, bits
+        bool ok = fread(header, sizeof(header), 1, file) == 1;
+        _boxes.resize(ok ? header[0] : 0);
+        _bits = ok ? header[1] : 0;
+        _labels.resize((_size * _bits + 63) / 64);
+        ok = ok && fread(_boxes.data(), sizeof(Box), _boxes.size(), file) == _boxes.size();
+        ok = ok && fread(_labels.data(), sizeof(uint64_t), _labels.size(), file) == _labels.size();
+        if (!ok)
+        {
+            throw std::runtime_error("ComponentMap: file " + filename + " is too short");
+        }
+    }
+    catch (...)
+    {
+        fclose(file);
+        throw;
+    }
+    fclose(file);
+}
+
+void ComponentMap::save(const std::string& filename, uint64_t hash) const
+{
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("ComponentMap::save: Could not open file " + filename);
+    }
+    writePrecomputedHeader(file, "comp", hash, _dof);
+    uint32_t header[2] = {(uint32_t)_boxes.size(), (uint32_t)_bits};
+    fwrite(header, sizeof(header), 1, file);
+    fwrite(_boxes.data(), sizeof(Box), _boxes.size(), file);
+    fwrite(_labels.data(), sizeof(uint64_t), _labels.size(), file);
+    fclose(file);
+}
+
+size_t ComponentMap::components() const
+{
+    return _boxes.size();
+}
+size_t ComponentMap::component(const JointState& state) const
+{
+    return label(index(state));
+}
+bool ComponentMap::connected(const JointState& state1, const JointState& state2) const
+{
+    size_t label1 = component(state1);
+    return label1 != 0 && label1 == component(state2);
+}
+bool ComponentMap::mayReach(const JointState& state, double x, double y, double eps) const
+{
+    size_t label = component(state);
+    if (label == 0)
+    {
+        return false;
+    }
+    const Box& box = _boxes[label - 1];
+    return x >= box.minX - eps && x <= box.maxX + eps && y >= box.minY - eps && y <= box.maxY + eps;
+}
+
+size_t ComponentMap::index(const JointState& state) const
+{
+    size_t id = 0;
+    size_t stride = 1;
+    for (size_t i = 0; i < _dof; ++i)
+    {
+        id += (state[i] + g_units) * stride;
+        stride *= 2 * g_units;
+    }
+    return id;
+}
+size_t ComponentMap::label(size_t id) const
+{
+    size_t bit = id * _bits;
+    uint64_t value = _labels[bit / 64] >> (bit % 64);
+    if (bit % 64 + _bits > 64)
+    {
+        value |= _labels[bit / 64 + 1] << (64 - bit % 64);
+    }
+    return value & ((1ull << _bits) - 1);
+}
+void ComponentMap::pack(const vector<uint32_t>& labels)
+{
+    _bits = 1;
+    while ((1ull << _bits) <= _boxes.size())
+    {
+        ++_bits;
+    }
+    _labels.assign((_size * _bits + 63) / 64, 0);
+    for (size_t id = 0; id < _size; ++id)
+    {
+        size_t bit = id * _bits;
+        _labels[bit / 64] |= (uint64_t)labels[id] << (bit % 64);
+        if (bit % 64 + _bits > 64)
+        {
+            _labels[bit / 64 + 1] |= (uint64_t)labels[id] >> (64 - bit % 64);
+        }
+    }
+}
+
+std::shared_ptr<ComponentMap> loadComponentMap(const ManipulatorPlanner& planner, const std::string& modelFilename)
+{
+    return std::make_shared<ComponentMap>(planner.dof(), precomputedFilename(modelFilename, "components"),
+        modelHash(planner.model()));
+}
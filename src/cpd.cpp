@@ -0,0 +1,247 @@
+#include "cpd.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+CompressedPathDatabase::CompressedPathDatabase(std::shared_ptr<const Lattice> lattice, size_t threads)
+{
+    _lattice = lattice;
+    if (_lattice->dof() > 2)
+    {
+        throw std::runtime_error("CompressedPathDatabase: only 1 and 2 dof are supported");
+    }
+    initMorton();
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // free states in Morton order, only they can be targets
+    vector<uint32_t> targets;
+    for (size_t id = 0; id < _lattice->size(); ++id)
+    {
+        if (_lattice->isFree(id))
+        {
+            targets.push_back(id);
+        }
+    }
+    std::sort(targets.begin(), targets.end(), [this](uint32_t a, uint32_t b) { return _morton[a] < _morton[b]; });
+
+    // every thread builds rows of its sources
+    vector<vector<uint32_t>> rows(_lattice->size());
+    auto work = [this, threads, &rows, &targets](size_t id)
+    {
+        vector<int> dist(_lattice->size(), -1);
+        vector<uint8_t> first(_lattice->size(), noAction);
+        vector<size_t> queue;
+        for (size_t source = id; source < _lattice->size(); source += threads)
+        {
+            if (_lattice->isFree(source))
+            {
+                rows[source] = buildRow(source, targets, dist, first, queue);
+            }
+        }
+    };
+    vector<std::thread> workers;
+    for (size_t id = 0; id < threads; ++id)
+    {
+        workers.emplace_back(work, id);
+    }
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    _rowBegin.assign(1, 0);
+    for (vector<uint32_t>& row : rows)
+    {
+        _runs.insert(_runs.end(), row.begin(), row.end());
+        _rowBegin.push_back(_runs.size());
+        vector<uint32_t>().swap(row);
+    }
+}
+
+CompressedPathDatabase::CompressedPathDatabase(std::shared_ptr<const Lattice> lattice, const std::string& filename, uint64_t hash)
+{
+    _lattice = lattice;
+    initMorton();
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("CompressedPathDatabase: Could not open file " + filename);
+    }
+    try
+    {
+        readPrecomputedHeader(file, "cpd", hash, _lattice->dof());
+        uint32_t runs = 0;
+        bool ok = fread(&runs, sizeof(runs), 1, file) == 1;
+        _rowBegin.resize(_lattice->size() + 1);
+        _runs.resize(ok ? runs : 0);
+        ok = ok && fread(_rowBegin.data(), sizeof(uint32_t), _rowBegin.size(), file) == _rowBegin.size();
+        ok = ok && fread(_runs.data(), sizeof(uint32_t), _runs.size(), file) == _runs.size();
+        if (!ok)
+        {
+            throw std::runtime_error("CompressedPathDatabase: file " + filename + " is too short");
+        }
+    }
+    catch (...)
+    {
+        fclose(file);
+        throw;
+    }
+    fclose(file);
+}
+
+void CompressedPathDatabase::save(const std::string& filename, uint64_t hash) const
+{
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("CompressedPathDatabase::save: Could not open file " + filename);
+    }
+    writePrecomputedHeader(file, "cpd", hash, _lattice->dof());
+    uint32_t runs = _runs.size();
+    fwrite(&runs, sizeof(runs), 1, file);
+    fwrite(_rowBegin.data(), sizeof(uint32_t), _rowBegin.size(), file);
+    fwrite(_runs.data(), sizeof(uint32_t), _runs.size(), file);
+    fclose(file);
+}
+
+Solution CompressedPathDatabase::plan(const JointState& startPos, const JointState& goalPos,
+    const vector<Action>& primitiveActions, const Action& zeroAction) const
+{
+    Solution solution(primitiveActions, zeroAction);
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    size_t current = _lattice->index(startPos);
+    size_t goal = _lattice->index(goalPos);
+    solution.stats.pathVerdict = PATH_FOUND;
+    // optimal path visits every state at most once
+    for (size_t step = 0; current != goal; ++step)
+    {
+        uint8_t action = firstAction(current, goal);
+        if (action == noAction || step == _lattice->size())
+        {
+            solution = Solution(primitiveActions, zeroAction);
+            solution.stats.pathVerdict = PATH_NOT_EXISTS;
+            break;
+        }
+        solution.addAction(action);
+        ++solution.stats.pathCost;
+        current = _lattice->neighbour(current, action);
+    }
+    if (solution.stats.pathVerdict == PATH_FOUND)
+    {
+        solution.stats.pathPotentialCost = manhattanHeuristic(startPos, goalPos);
+    }
+    solution.stats.runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return solution;
+}
+
+uint8_t CompressedPathDatabase::firstAction(size_t source, size_t target) const
+{
+    if (_rowBegin[source] == _rowBegin[source + 1])
+    {
+        return noAction;
+    }
+    // the last run which starts not after target
+    uint32_t key = (_morton[target] << 8) | 0xFF;
+    auto first = _runs.begin() + _rowBegin[source];
+    auto last = _runs.begin() + _rowBegin[source + 1];
+    auto it = std::upper_bound(first, last, key);
+    return it == first ? noAction : *(it - 1) & 0xFF;
+}
+
+size_t CompressedPathDatabase::runs() const
+{
+    return _runs.size();
+}
+
+void CompressedPathDatabase::initMorton()
+{
+    size_t bits = 0; // bits in one coordinate
+    while ((1u << bits) < 2 * g_units)
+    {
+        ++bits;
+    }
+    _morton.resize(_lattice->size());
+    for (size_t id = 0; id < _lattice->size(); ++id)
+    {
+        uint32_t morton = 0;
+        size_t rest = id;
+        for (size_t joint = 0; joint < _lattice->dof(); ++joint)
+        {
+            uint32_t digit = rest % (2 * g_units);
+            rest /= 2 * g_units;
+            for (size_t bit = 0; bit < bits; ++bit)
+            {
+                morton |= ((digit >> bit) & 1) << (bit * _lattice->dof() + joint);
+            }
+        }
+        _morton[id] = morton;
+    }
+}
+
+vector<uint32_t> CompressedPathDatabase::buildRow(size_t source, const vector<uint32_t>& targets,
+    vector<int>& dist, vector<uint8_t>& first, vector<size_t>& queue) const
+{
+    // breadth-first search which remembers the first action of path
+    queue.assign(1, source);
+    dist[source] = 0;
+    for (size_t head = 0; head < queue.size(); ++head)
+    {
+        size_t current = queue[head];
+        for (size_t a = 0; a < _lattice->actions(); ++a)
+        {
+            if (!_lattice->hasEdge(current, a))
+            {
+                continue;
+            }
+            size_t next = _lattice->neighbour(current, a);
+            if (dist[next] >= 0)
+            {
+                continue;
+            }
+            dist[next] = dist[current] + 1;
+            first[next] = current == source ? a : first[current];
+            queue.push_back(next);
+        }
+    }
+
+    vector<uint32_t> row;
+    for (uint32_t target : targets)
+    {
+        // actions to obstacles and to source itself are never asked
+        if (target == source)
+        {
+            continue;
+        }
+        uint32_t morton = _morton[target];
+        uint8_t action = dist[target] >= 0 ? first[target] : noAction;
+        if (row.empty())
+        {
+            row.push_back(action); // the first run starts at 0
+        }
+        else if ((row.back() & 0xFF) != action)
+        {
+            row.push_back((morton << 8) | action);
+        }
+    }
+
+    for (size_t state : queue)
+    {
+        dist[state] = -1;
+        first[state] = noAction;
+    }
+    return row;
+}
+
+std::shared_ptr<CompressedPathDatabase> loadPathDatabase(const ManipulatorPlanner& planner, const std::string& modelFilename)
+{
+    uint64_t hash = modelHash(planner.model());
+    std::shared_ptr<Lattice> lattice = std::make_shared<Lattice>(planner.dof());
+    lattice->load(precomputedFilename(modelFilename, "lattice"), hash);
+    return std::make_shared<CompressedPathDatabase>(lattice, precomputedFilename(modelFilename, "cpd"), hash);
+}
@@ -0,0 +1,264 @@
+#include "experience.h"
+#include "lattice.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+
+ExperienceCache::ExperienceCache(ManipulatorPlanner& planner, size_t capacity)
+{
+    _planner = &planner;
+    _capacity = capacity;
+}
+
+Solution ExperienceCache::planActions(const JointState& startPos, const JointState& goalPos,
+    double timeLimit, double w)
+{
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    Iterator best = _experiences.end();
+    int bestDistance = std::numeric_limits<int>::max();
+    for (Iterator it = _experiences.begin(); it != _experiences.end(); ++it)
+    {
+        int startDistance = manhattanDistance(startPos, it->path.front());
+        int goalDistance = manhattanDistance(goalPos, it->path.back());
+        if (startDistance <= (int)maxRepairDistance && goalDistance <= (int)maxRepairDistance &&
+            startDistance + goalDistance < bestDistance)
+        {
+            best = it;
+            bestDistance = startDistance + goalDistance;
+        }
+    }
+
+    Solution solution;
+    if (best != _experiences.end() && reuse(best, startPos, &goalPos, timeLimit, solution))
+    {
+        solution.stats.runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        return solution;
+    }
+    solution = _planner->planActions(startPos, goalPos, ALG_ASTAR, timeLimit, w);
+    remember(startPos, solution);
+    return solution;
+}
+
+Solution ExperienceCache::planActions(const JointState& startPos, double goalX, double goalY,
+    double timeLimit, double w)
+{
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    Iterator best = _experiences.end();
+    int bestDistance = std::numeric_limits<int>::max();
+    for (Iterator it = _experiences.begin(); it != _experiences.end(); ++it)
+    {
+        double dx = it->endX - goalX;
+        double dy = it->endY - goalY;
+        int startDistance = manhattanDistance(startPos, it->path.front());
+        if (dx * dx + dy * dy <= g_goalRadius * g_goalRadius && startDistance <= (int)maxRepairDistance &&
+            startDistance < bestDistance)
+        {
+            best = it;
+            bestDistance = startDistance;
+        }
+    }
+
+    Solution solution;
+    if (best != _experiences.end() && reuse(best, startPos, nullptr, timeLimit, solution))
+    {
+        solution.stats.runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        return solution;
+    }
+    solution = _planner->planActions(startPos, goalX, goalY, ALG_ASTAR, timeLimit, w);
+    remember(startPos, solution);
+    return solution;
+}
+
+void ExperienceCache::save(const std::string& filename) const
+{
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("ExperienceCache::save: Could not open file " + filename);
+    }
+    writePrecomputedHeader(file, "exp", modelHash(_planner->model()), _planner->dof());
+    uint32_t count = _experiences.size();
+    fwrite(&count, sizeof(count), 1, file);
+    for (const Experience& experience : _experiences)
+    {
+        uint32_t length = experience.path.size();
+        fwrite(&length, sizeof(length), 1, file);
+        fwrite(&experience.endX, sizeof(double), 1, file);
+        fwrite(&experience.endY, sizeof(double), 1, file);
+        for (const JointState& state : experience.path)
+        {
+            for (size_t i = 0; i < state.dof(); ++i)
+            {
+                int32_t joint = state[i];
+                fwrite(&joint, sizeof(joint), 1, file);
+            }
+        }
+    }
+    fclose(file);
+}
+bool ExperienceCache::load(const std::string& filename)
+{
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+    std::list<Experience> experiences;
+    try
+    {
+        readPrecomputedHeader(file, "exp", modelHash(_planner->model()), _planner->dof());
+        uint32_t count = 0;
+        bool ok = fread(&count, sizeof(count), 1, file) == 1;
+        for (uint32_t e = 0; e < count && ok; ++e)
+        {
+            Experience experience;
+            uint32_t length = 0;
+            ok = fread(&length, sizeof(length), 1, file) == 1 && length > 0 &&
+                fread(&experience.endX, sizeof(double), 1, file) == 1 &&
+                fread(&experience.endY, sizeof(double), 1, file) == 1;
+            vector<int32_t> joints(_planner->dof());
+            for (uint32_t s = 0; s < length && ok; ++s)
+            {
+                ok = fread(joints.data(), sizeof(int32_t), joints.size(), file) == joints.size();
+                JointState state(_planner->dof());
+                for (size_t i = 0; i < joints.size(); ++i)
+                {
+                    state[i] = joints[i];
+                }
+                experience.path.push_back(state);
+            }
+            experiences.push_back(experience);
+        }
+        if (!ok)
+        {
+            throw std::runtime_error("ExperienceCache::load: file " + filename + " is broken");
+        }
+    }
+    catch (...)
+    {
+        fclose(file);
+        throw;
+    }
+    fclose(file);
+    _experiences = experiences;
+    while (_experiences.size() > _capacity)
+    {
+        _experiences.pop_back();
+    }
+    return true;
+}
+
+size_t ExperienceCache::size() const
+{
+    return _experiences.size();
+}
+size_t ExperienceCache::hits() const
+{
+    return _hits;
+}
+
+bool ExperienceCache::reuse(Iterator experience, const JointState& startPos, const JointState* goalPos,
+    double timeLimit, Solution& solution)
+{
+    // the reused part is checked again, model of scene may have changed after path was stored
+    const vector<JointState>& stored = experience->path;
+    for (size_t i = 0; i + 1 < stored.size(); ++i)
+    {
+        if (_planner->checkCollisionAction(stored[i], difference(stored[i], stored[i + 1])))
+        {
+            _experiences.erase(experience);
+            return false;
+        }
+    }
+
+    Stats stats;
+    vector<JointState> path = {startPos.withoutLastAction()};
+    if (!connect(startPos, stored.front(), timeLimit / 2, path, stats))
+    {
+        return false;
+    }
+    path.insert(path.end(), stored.begin() + 1, stored.end());
+    if (goalPos != nullptr && !connect(stored.back(), *goalPos, timeLimit / 2, path, stats))
+    {
+        return false;
+    }
+
+    solution = toSolution(path);
+    solution.stats.expansions = stats.expansions;
+    solution.stats.maxTreeSize = stats.maxTreeSize;
+    if (goalPos != nullptr)
+    {
+        solution.stats.pathPotentialCost = manhattanHeuristic(startPos, *goalPos);
+    }
+    _experiences.splice(_experiences.begin(), _experiences, experience);
+    ++_hits;
+    return true;
+}
+
+bool ExperienceCache::connect(const JointState& start, const JointState& goal, double timeLimit,
+    vector<JointState>& path, Stats& stats)
+{
+    if (start == goal)
+    {
+        return true;
+    }
+    Solution local = _planner->planActions(start, goal, ALG_ASTAR, timeLimit, 1.0);
+    stats.expansions += local.stats.expansions;
+    stats.maxTreeSize = std::max(stats.maxTreeSize, local.stats.maxTreeSize);
+    if (local.stats.pathVerdict != PATH_FOUND)
+    {
+        return false;
+    }
+    JointState current = start;
+    while (!local.goalAchieved())
+    {
+        current.apply(local.nextAction());
+        path.push_back(current.withoutLastAction());
+    }
+    return true;
+}
+
+void ExperienceCache::remember(const JointState& startPos, const Solution& solution)
+{
+    if (solution.stats.pathVerdict != PATH_FOUND || _capacity == 0)
+    {
+        return;
+    }
+    Experience experience;
+    experience.path = {startPos.withoutLastAction()};
+    for (size_t i = 0; i < solution.size(); ++i)
+    {
+        experience.path.push_back(experience.path.back().applied(solution.getAction(i)).withoutLastAction());
+    }
+    std::pair<double, double> xy = _planner->sitePosition(experience.path.back());
+    experience.endX = xy.first;
+    experience.endY = xy.second;
+    _experiences.push_front(experience);
+    if (_experiences.size() > _capacity)
+    {
+        _experiences.pop_back();
+    }
+}
+
+Solution ExperienceCache::toSolution(const vector<JointState>& path) const
+{
+    Solution solution(_planner->primitiveActions(), Action(_planner->dof(), 0));
+    // local searches may return to states of stored path, such loops are cut
+    vector<JointState> simple;
+    for (const JointState& state : path)
+    {
+        auto it = std::find(simple.begin(), simple.end(), state);
+        simple.erase(it, simple.end());
+        simple.push_back(state);
+    }
+    for (size_t i = 0; i + 1 < simple.size(); ++i)
+    {
+        Action action = difference(simple[i], simple[i + 1]);
+        solution.addAction(action);
+        solution.stats.pathCost += action.abs();
+    }
+    solution.stats.pathVerdict = PATH_FOUND;
+    return solution;
+}
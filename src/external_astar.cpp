@@ -0,0 +1,663 @@
+#include "external_astar.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <unordered_set>
+#include <stdexcept>
+#include <stdint.h>
+#include <unistd.h>
+
+namespace astar
+{
+
+namespace
+{
+
+// node of search tree in format of files
+struct DiskNode
+{
+    float g;
+    float h;
+    int32_t stepNum; // -1 if node has not parent
+    int32_t joints[g_maxDof];
+
+    float f() const
+    {
+        return g + h;
+    }
+};
+
+struct Bucket
+{
+    std::string filename;
+    size_t onDisk = 0;
+    vector<DiskNode> buffer;
+};
+
+// states of nodes expanded in the current layer, unused joints of nodes are zero
+struct StateHash
+{
+    size_t operator()(const DiskNode& node) const
+    {
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ull;
+        for (int32_t joint : node.joints)
+        {
+            hash = (hash ^ (uint32_t)joint) * 1099511628211ull;
+        }
+        return hash;
+    }
+};
+struct StateEqual
+{
+    bool operator()(const DiskNode& a, const DiskNode& b) const
+    {
+        return std::equal(a.joints, a.joints + g_maxDof, b.joints);
+    }
+};
+
+class ExternalSearch
+{
+public:
+    ExternalSearch(size_t dof, const ExternalMemoryConfig& config);
+    ~ExternalSearch();
+
+    void addToOpen(const DiskNode& node);
+    bool haveOpen() const;
+    std::pair<float, float> bestKey() const;
+    // removes the best bucket from open and returns its file and nodes from memory
+    Bucket extractBestBucket();
+    // reads at most n nodes
+    vector<DiskNode> readNodes(FILE* file, size_t n) const;
+    // removes duplicates and nodes which are closed or expanded in the current layer.
+    // Small portion looks for nodes by binary search, large one merges with partitions
+    vector<DiskNode> removeClosed(vector<DiskNode> nodes) const;
+    bool inLayer(const DiskNode& node) const;
+    // expanded nodes are kept in memory and are merged into closed list by closeLayer(),
+    // large layer is merged when it reaches memoryNodes
+    void addToLayer(const DiskNode& node);
+    void closeLayer();
+    bool findClosed(const JointState& state, DiskNode& result) const;
+
+    DiskNode toDiskNode(const JointState& state, float g, float h, int stepNum) const;
+    JointState toState(const DiskNode& node) const;
+
+    size_t size() const;
+
+private:
+    int compareStates(const DiskNode& a, const DiskNode& b) const;
+    // binary search of state of key in sorted file of size nodes
+    bool findInFile(FILE* file, size_t size, const DiskNode& key, DiskNode& result) const;
+    size_t partition(const DiskNode& node) const;
+    // sorts nodes by partition and state
+    void sortNodes(vector<DiskNode>& nodes) const;
+    void addToClosed(vector<DiskNode> nodes);
+    std::string closedFilename(size_t partition) const;
+    void flush(Bucket& bucket);
+    void flushAll();
+    void appendNodes(const std::string& filename, const vector<DiskNode>& nodes) const;
+
+    size_t _dof;
+    ExternalMemoryConfig _config;
+    std::string _directory;
+    // buckets are sorted by f and then by -g like in astar()
+    std::map<std::pair<float, float>, Bucket> _open;
+    std::unordered_set<DiskNode, StateHash, StateEqual> _layer;
+    size_t _buffered = 0;
+    size_t _openSize = 0;
+    size_t _closedSize = 0;
+    size_t _filesCreated = 0;
+    vector<std::string> _files;
+};
+
+ExternalSearch::ExternalSearch(size_t dof, const ExternalMemoryConfig& config)
+{
+    if (dof > g_maxDof)
+    {
+        throw std::runtime_error("externalAstar: dof is greater than g_maxDof");
+    }
+    _dof = dof;
+    _config = config;
+    _config.memoryNodes = std::max<size_t>(_config.memoryNodes, 2);
+    _config.partitions = std::max<size_t>(_config.partitions, 1);
+
+    std::string pattern = _config.directory + "/external_astar_XXXXXX";
+    vector<char> buffer(pattern.begin(), pattern.end());
+    buffer.push_back('\0');
+    if (mkdtemp(buffer.data()) == nullptr)
+    {
+        throw std::runtime_error("externalAstar: Could not create directory in " + _config.directory);
+    }
+    _directory = buffer.data();
+    for (size_t i = 0; i < _config.partitions; ++i)
+    {
+        _files.push_back(closedFilename(i));
+    }
+}
+ExternalSearch::~ExternalSearch()
+{
+    for (const std::string& filename : _files)
+    {
+        std::remove(filename.c_str());
+    }
+    rmdir(_directory.c_str());
+}
+
+void ExternalSearch::addToOpen(const DiskNode& node)
+{
+    std::pair<float, float> key = {node.f(), -node.g};
+    auto it = _open.find(key);
+    if (it == _open.end())
+    {
+        it = _open.emplace(key, Bucket()).first;
+        it->second.filename = _directory + "/open_" + std::to_string(_filesCreated++) + ".bin";
+        _files.push_back(it->second.filename);
+    }
+    it->second.buffer.push_back(node);
+    ++_buffered;
+    ++_openSize;
+    if (_buffered * 2 > _config.memoryNodes)
+    {
+        flushAll();
+    }
+}
+bool ExternalSearch::haveOpen() const
+{
+    return !_open.empty();
+}
+std::pair<float, float> ExternalSearch::bestKey() const
+{
+    return _open.begin()->first;
+}
+Bucket ExternalSearch::extractBestBucket()
+{
+    Bucket bucket = std::move(_open.begin()->second);
+    _open.erase(_open.begin());
+    _buffered -= bucket.buffer.size();
+    _openSize -= bucket.buffer.size() + bucket.onDisk;
+    return bucket;
+}
+
+vector<DiskNode> ExternalSearch::readNodes(FILE* file, size_t n) const
+{
+    vector<DiskNode> nodes(n);
+    nodes.resize(fread(nodes.data(), sizeof(DiskNode), n, file));
+    return nodes;
+}
+
+vector<DiskNode> ExternalSearch::removeClosed(vector<DiskNode> nodes) const
+{
+    sortNodes(nodes);
+    // nodes of one bucket have the same g, so any copy of state is the best one
+    nodes.erase(std::unique(nodes.begin(), nodes.end(), [this](const DiskNode& a, const DiskNode& b)
+    {
+        return compareStates(a, b) == 0;
+    }), nodes.end());
+    nodes.erase(std::remove_if(nodes.begin(), nodes.end(), [this](const DiskNode& node)
+    {
+        return inLayer(node);
+    }), nodes.end());
+
+    vector<DiskNode> result;
+    size_t begin = 0;
+    while (begin < nodes.size())
+    {
+        size_t p = partition(nodes[begin]);
+        size_t end = begin;
+        while (end < nodes.size() && partition(nodes[end]) == p)
+        {
+            ++end;
+        }
+        FILE* file = fopen(closedFilename(p).c_str(), "rb"); // there is not file for empty partition
+        size_t size = 0;
+        if (file != nullptr)
+        {
+            fseek(file, 0, SEEK_END);
+            size = ftell(file) / sizeof(DiskNode);
+            fseek(file, 0, SEEK_SET);
+        }
+        DiskNode closed;
+        bool search = (end - begin) * 32 < size;
+        for (size_t i = begin; i < end && search; ++i)
+        {
+            if (!findInFile(file, size, nodes[i], closed))
+            {
+                result.push_back(nodes[i]);
+            }
+        }
+        // partition and nodes are sorted, so one pass is enough
+        bool haveClosed = !search && file != nullptr && fread(&closed, sizeof(DiskNode), 1, file) == 1;
+        for (size_t i = begin; i < end && !search; ++i)
+        {
+            while (haveClosed && compareStates(closed, nodes[i]) < 0)
+            {
+                haveClosed = fread(&closed, sizeof(DiskNode), 1, file) == 1;
+            }
+            if (!haveClosed || compareStates(closed, nodes[i]) != 0)
+            {
+                result.push_back(nodes[i]);
+            }
+        }
+        if (file != nullptr)
+        {
+            fclose(file);
+        }
+        begin = end;
+    }
+    return result;
+}
+
+bool ExternalSearch::inLayer(const DiskNode& node) const
+{
+    return _layer.count(node) > 0;
+}
+void ExternalSearch::addToLayer(const DiskNode& node)
+{
+    _layer.insert(node);
+    if (_layer.size() >= _config.memoryNodes)
+    {
+        closeLayer();
+    }
+}
+void ExternalSearch::closeLayer()
+{
+    addToClosed(vector<DiskNode>(_layer.begin(), _layer.end()));
+    _layer.clear();
+}
+
+void ExternalSearch::addToClosed(vector<DiskNode> nodes)
+{
+    sortNodes(nodes);
+    size_t begin = 0;
+    while (begin < nodes.size())
+    {
+        size_t p = partition(nodes[begin]);
+        size_t end = begin;
+        while (end < nodes.size() && partition(nodes[end]) == p)
+        {
+            ++end;
+        }
+
+        // merge sorted partition with sorted nodes
+        std::string filename = closedFilename(p);
+        std::string tmpFilename = filename + ".tmp";
+        FILE* oldFile = fopen(filename.c_str(), "rb");
+        FILE* newFile = fopen(tmpFilename.c_str(), "wb");
+        if (newFile == nullptr)
+        {
+            throw std::runtime_error("externalAstar: Could not open file " + tmpFilename);
+        }
+        DiskNode old;
+        bool haveOld = oldFile != nullptr && fread(&old, sizeof(DiskNode), 1, oldFile) == 1;
+        size_t i = begin;
+        while (haveOld || i < end)
+        {
+            int cmp = !haveOld ? 1 : (i == end ? -1 : compareStates(old, nodes[i]));
+            if (cmp <= 0)
+            {
+                fwrite(&old, sizeof(DiskNode), 1, newFile);
+                haveOld = fread(&old, sizeof(DiskNode), 1, oldFile) == 1;
+                i += (cmp == 0); // state was closed earlier
+            }
+            else
+            {
+                fwrite(&nodes[i], sizeof(DiskNode), 1, newFile);
+                ++_closedSize;
+                ++i;
+            }
+        }
+        if (oldFile != nullptr)
+        {
+            fclose(oldFile);
+        }
+        fclose(newFile);
+        if (std::rename(tmpFilename.c_str(), filename.c_str()) != 0)
+        {
+            throw std::runtime_error("externalAstar: Could not rename file " + tmpFilename);
+        }
+        begin = end;
+    }
+}
+
+bool ExternalSearch::findClosed(const JointState& state, DiskNode& result) const
+{
+    DiskNode key = toDiskNode(state, 0, 0, -1);
+    FILE* file = fopen(closedFilename(partition(key)).c_str(), "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    bool found = findInFile(file, ftell(file) / sizeof(DiskNode), key, result);
+    fclose(file);
+    return found;
+}
+
+DiskNode ExternalSearch::toDiskNode(const JointState& state, float g, float h, int stepNum) const
+{
+    DiskNode node = {g, h, stepNum, {}};
+    for (size_t i = 0; i < _dof; ++i)
+    {
+        node.joints[i] = state[i];
+    }
+    return node;
+}
+JointState ExternalSearch::toState(const DiskNode& node) const
+{
+    JointState state(_dof, 0);
+    for (size_t i = 0; i < _dof; ++i)
+    {
+        state[i] = node.joints[i];
+    }
+    return state;
+}
+
+size_t ExternalSearch::size() const
+{
+    return _openSize + _closedSize + _layer.size();
+}
+
+int ExternalSearch::compareStates(const DiskNode& a, const DiskNode& b) const
+{
+    for (size_t i = 0; i < _dof; ++i)
+    {
+        if (a.joints[i] != b.joints[i])
+        {
+            return a.joints[i] < b.joints[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+bool ExternalSearch::findInFile(FILE* file, size_t size, const DiskNode& key, DiskNode& result) const
+{
+    size_t left = 0, right = size;
+    while (left < right)
+    {
+        size_t mid = (left + right) / 2;
+        fseek(file, mid * sizeof(DiskNode), SEEK_SET);
+        if (fread(&result, sizeof(DiskNode), 1, file) != 1)
+        {
+            return false;
+        }
+        int cmp = compareStates(result, key);
+        if (cmp == 0)
+        {
+            return true;
+        }
+        if (cmp < 0)
+        {
+            left = mid + 1;
+        }
+        else
+        {
+            right = mid;
+        }
+    }
+    return false;
+}
+size_t ExternalSearch::partition(const DiskNode& node) const
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < _dof; ++i)
+    {
+        hash = (hash ^ (uint32_t)node.joints[i]) * 1099511628211ull;
+    }
+    return hash % _config.partitions;
+}
+void ExternalSearch::sortNodes(vector<DiskNode>& nodes) const
+{
+    std::sort(nodes.begin(), nodes.end(), [this](const DiskNode& a, const DiskNode& b)
+    {
+        size_t pa = partition(a), pb = partition(b);
+        return pa != pb ? pa < pb : compareStates(a, b) < 0;
+    });
+}
+std::string ExternalSearch::closedFilename(size_t partition) const
+{
+    return _directory + "/closed_" + std::to_string(partition) + ".bin";
+}
+
+void ExternalSearch::flush(Bucket& bucket)
+{
+    appendNodes(bucket.filename, bucket.buffer);
+    bucket.onDisk += bucket.buffer.size();
+    _buffered -= bucket.buffer.size();
+    bucket.buffer.clear();
+    bucket.buffer.shrink_to_fit();
+}
+void ExternalSearch::flushAll()
+{
+    for (auto& it : _open)
+    {
+        if (!it.second.buffer.empty())
+        {
+            flush(it.second);
+        }
+    }
+}
+void ExternalSearch::appendNodes(const std::string& filename, const vector<DiskNode>& nodes) const
+{
+    FILE* file = fopen(filename.c_str(), "ab");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("externalAstar: Could not open file " + filename);
+    }
+    if (fwrite(nodes.data(), sizeof(DiskNode), nodes.size(), file) != nodes.size())
+    {
+        fclose(file);
+        throw std::runtime_error("externalAstar: Could not write file " + filename);
+    }
+    fclose(file);
+}
+
+// bucket which is being expanded
+struct Frame
+{
+    std::pair<float, float> key;
+    Bucket bucket;
+    FILE* file = nullptr;
+    vector<DiskNode> nodes; // the current portion without closed nodes
+    size_t next = 0;
+    bool lastPortion = false;
+};
+
+void closeFrame(Frame& frame)
+{
+    if (frame.file != nullptr)
+    {
+        fclose(frame.file);
+        frame.file = nullptr;
+    }
+    std::remove(frame.bucket.filename.c_str());
+}
+
+} // namespace
+
+Solution externalAstar(
+    const JointState& startPos,
+    IAstarChecker& checker,
+    double weight,
+    const SearchControl& control,
+    const ExternalMemoryConfig& config
+)
+{
+    Solution solution(checker.getActions(), checker.getZeroAction());
+    const vector<Action>& actions = checker.getActions();
+    size_t dof = startPos.dof();
+
+    // to restore path we need to know reverse actions
+    vector<size_t> reverse(actions.size());
+    for (size_t i = 0; i < actions.size(); ++i)
+    {
+        Action negative(dof, 0);
+        for (size_t j = 0; j < dof; ++j)
+        {
+            negative[j] = -actions[i][j];
+        }
+        reverse[i] = actions.size();
+        for (size_t j = 0; j < actions.size(); ++j)
+        {
+            if (manhattanDistance(actions[j], negative) == 0)
+            {
+                reverse[i] = j;
+            }
+        }
+        if (reverse[i] == actions.size())
+        {
+            throw std::runtime_error("externalAstar: actions of checker are not reversible");
+        }
+    }
+
+    // start timer
+    Clock::time_point start = Clock::now();
+
+    ExternalSearch search(dof, config);
+    search.addToOpen(search.toDiskNode(startPos, 0, checker.heuristic(startPos) * weight, -1));
+
+    bool found = false;
+    bool stopped = false;
+    DiskNode goal;
+    // buckets which are being expanded, the last one is the best. Successors with the same f
+    // get into better buckets, they are expanded before the rest of bucket which is in memory
+    // like in astar(). Bucket which was read from disk is always expanded completely
+    vector<Frame> frames;
+    size_t framed = 0; // nodes of frames in memory
+    float layerF = -1;
+    while (!found && !stopped)
+    {
+        if (search.haveOpen() && (frames.empty() || (search.bestKey() < frames.back().key &&
+            frames.back().file == nullptr && framed < config.memoryNodes)))
+        {
+            Frame frame;
+            frame.key = search.bestKey();
+            frame.bucket = search.extractBestBucket();
+            frame.file = frame.bucket.onDisk > 0 ? fopen(frame.bucket.filename.c_str(), "rb") : nullptr;
+            // closed nodes of the previous f are merged once
+            if (frame.key.first != layerF)
+            {
+                search.closeLayer();
+                layerF = frame.key.first;
+            }
+            frames.push_back(std::move(frame));
+            continue;
+        }
+        if (frames.empty())
+        {
+            break;
+        }
+        Frame& frame = frames.back();
+        if (frame.next == frame.nodes.size())
+        {
+            framed -= frame.nodes.size();
+            frame.nodes.clear();
+            frame.next = 0;
+            if (frame.lastPortion)
+            {
+                closeFrame(frame);
+                frames.pop_back();
+                continue;
+            }
+            vector<DiskNode> portion;
+            if (frame.file != nullptr)
+            {
+                portion = search.readNodes(frame.file, config.memoryNodes);
+            }
+            if (portion.empty())
+            {
+                portion = std::move(frame.bucket.buffer);
+                frame.lastPortion = true;
+                if (frame.file != nullptr)
+                {
+                    fclose(frame.file);
+                    frame.file = nullptr;
+                }
+            }
+            frame.nodes = search.removeClosed(std::move(portion));
+            framed += frame.nodes.size();
+            continue;
+        }
+
+        DiskNode node = frame.nodes[frame.next++];
+        // state may be expanded from better bucket after its portion was read
+        if (search.inLayer(node))
+        {
+            continue;
+        }
+        JointState state = search.toState(node);
+        if (checker.isGoal(state))
+        {
+            found = true;
+            goal = node;
+            break;
+        }
+        // give up if time limit is exhausted or search is cancelled
+        if (control.shouldStop(solution.stats.expansions))
+        {
+            stopped = true;
+            break;
+        }
+        for (size_t i = 0; i < actions.size(); ++i)
+        {
+            const Action& action = actions[i];
+            if (!checker.isCorrect(state, action))
+            {
+                continue;
+            }
+            JointState newState = state.applied(action);
+            search.addToOpen(search.toDiskNode(newState,
+                node.g + checker.costAction(state, action),
+                checker.heuristic(newState) * weight,
+                i
+            ));
+        }
+        search.addToLayer(node);
+        ++solution.stats.expansions;
+        solution.stats.maxTreeSize = std::max(solution.stats.maxTreeSize, search.size() + framed);
+    }
+    for (Frame& frame : frames)
+    {
+        closeFrame(frame);
+    }
+    // parents of goal are looked up in closed list
+    search.closeLayer();
+
+    if (found)
+    {
+        solution.stats.pathVerdict = PATH_FOUND;
+        solution.stats.pathCost = goal.g;
+        solution.stats.pathPotentialCost = checker.heuristic(startPos);
+
+        vector<size_t> path;
+        DiskNode node = goal;
+        while (node.stepNum >= 0)
+        {
+            path.push_back(node.stepNum);
+            JointState parent = search.toState(node).applied(actions[reverse[node.stepNum]]);
+            if (!search.findClosed(parent, node))
+            {
+                throw std::runtime_error("externalAstar: parent of node is lost");
+            }
+        }
+        for (size_t i = path.size(); i > 0; --i)
+        {
+            solution.addAction(path[i - 1]);
+        }
+    }
+    else if (stopped)
+    {
+        solution.stats.pathVerdict = PATH_NOT_FOUND;
+    }
+    else
+    {
+        solution.stats.pathVerdict = PATH_NOT_EXISTS;
+    }
+
+    // end timer
+    solution.stats.runtime = std::chrono::duration<double>(Clock::now() - start).count();
+    return solution;
+}
+
+} // namespace astar
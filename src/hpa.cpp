@@ -0,0 +1,485 @@
+#include "hpa.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+
+HierarchicalGraph::HierarchicalGraph(std::shared_ptr<const Lattice> lattice, size_t blockSize, size_t threads)
+{
+    _lattice = lattice;
+    _blockSize = blockSize;
+    if (_blockSize == 0 || (2 * g_units) % _blockSize != 0)
+    {
+        throw std::runtime_error("HierarchicalGraph: blockSize must divide 2 * g_units");
+    }
+    _blocksInRow = 2 * g_units / _blockSize;
+    size_t blocks = 1;
+    _blockVolume = 1;
+    for (size_t i = 0; i < _lattice->dof(); ++i)
+    {
+        blocks *= _blocksInRow;
+        _blockVolume *= _blockSize;
+    }
+    _blockNodes.resize(blocks);
+
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    addEntrances();
+    addInnerEdges(threads);
+}
+
+HierarchicalGraph::HierarchicalGraph(std::shared_ptr<const Lattice> lattice, const std::string& filename, uint64_t hash)
+{
+    _lattice = lattice;
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("HierarchicalGraph: Could not open file " + filename);
+    }
+    try
+    {
+        readPrecomputedHeader(file, "hpa", hash, _lattice->dof());
+        uint32_t header[2];
+        if (fread(header, sizeof(header), 1, file) != 1)
+        {
+            throw std::runtime_error("HierarchicalGraph: file " + filename + " is too short");
+        }
+        _blockSize = header[0];
+        _blocksInRow = 2 * g_units / _blockSize;
+        size_t blocks = 1;
+        _blockVolume = 1;
+        for (size_t i = 0; i < _lattice->dof(); ++i)
+        {
+            blocks *= _blocksInRow;
+            _blockVolume *= _blockSize;
+        }
+        _blockNodes.resize(blocks);
+
+        vector<uint32_t> ids(header[1]);
+        _edges.resize(header[1]);
+        bool ok = fread(ids.data(), sizeof(uint32_t), ids.size(), file) == ids.size();
+        for (size_t node = 0; node < ids.size() && ok; ++node)
+        {
+            _nodes.push_back(ids[node]);
+            _nodeOf[ids[node]] = node;
+            _blockNodes[block(ids[node])].push_back(node);
+            uint32_t count = 0;
+            ok = fread(&count, sizeof(count), 1, file) == 1;
+            _edges[node].resize(count);
+            ok = ok && fread(_edges[node].data(), sizeof(Edge), count, file) == count;
+        }
+        if (!ok)
+        {
+            throw std::runtime_error("HierarchicalGraph: file " + filename + " is too short");
+        }
+    }
+    catch (...)
+    {
+        fclose(file);
+        throw;
+    }
+    fclose(file);
+}
+
+void HierarchicalGraph::save(const std::string& filename, uint64_t hash) const
+{
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("HierarchicalGraph::save: Could not open file " + filename);
+    }
+    writePrecomputedHeader(file, "hpa", hash, _lattice->dof());
+    uint32_t header[2] = {(uint32_t)_blockSize, (uint32_t)_nodes.size()};
+    fwrite(header, sizeof(header), 1, file);
+    vector<uint32_t> ids(_nodes.begin(), _nodes.end());
+    fwrite(ids.data(), sizeof(uint32_t), ids.size(), file);
+    for (const vector<Edge>& edges : _edges)
+    {
+        uint32_t count = edges.size();
+        fwrite(&count, sizeof(count), 1, file);
+        fwrite(edges.data(), sizeof(Edge), edges.size(), file);
+    }
+    fclose(file);
+}
+
+Solution HierarchicalGraph::plan(const JointState& startPos, const JointState& goalPos,
+    const vector<Action>& primitiveActions, const Action& zeroAction) const
+{
+    Solution solution(primitiveActions, zeroAction);
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    size_t start = _lattice->index(startPos);
+    size_t goal = _lattice->index(goalPos);
+    BlockTree startTree = searchBlock(start, false);
+    BlockTree goalTree = searchBlock(goal, true);
+
+    // abstract graph with two temporary nodes
+    const uint32_t startNode = _nodes.size();
+    const uint32_t goalNode = _nodes.size() + 1;
+    const uint32_t inf = std::numeric_limits<uint32_t>::max();
+    vector<uint32_t> g(_nodes.size() + 2, inf);
+    vector<uint32_t> parent(_nodes.size() + 2, inf);
+    vector<int32_t> parentEdge(_nodes.size() + 2, -1); // -1 for edges to temporary nodes
+    vector<bool> closed(_nodes.size() + 2, false);
+
+    auto heuristic = [&](uint32_t node)
+    {
+        if (node == goalNode)
+        {
+            return 0;
+        }
+        return manhattanDistance(_lattice->state(node == startNode ? start : _nodes[node]), goalPos);
+    };
+    using QueueItem = std::pair<uint32_t, uint32_t>; // f, node
+    std::priority_queue<QueueItem, vector<QueueItem>, std::greater<QueueItem>> open;
+    auto relax = [&](uint32_t from, uint32_t to, uint32_t cost, int32_t edge)
+    {
+        if (g[from] + cost < g[to])
+        {
+            g[to] = g[from] + cost;
+            parent[to] = from;
+            parentEdge[to] = edge;
+            open.push({g[to] + heuristic(to), to});
+        }
+    };
+
+    g[startNode] = 0;
+    open.push({heuristic(startNode), startNode});
+    while (!open.empty())
+    {
+        uint32_t node = open.top().second;
+        open.pop();
+        if (closed[node])
+        {
+            continue;
+        }
+        closed[node] = true;
+        if (node == goalNode)
+        {
+            break;
+        }
+        ++solution.stats.expansions;
+
+        if (node == startNode)
+        {
+            for (uint32_t next : _blockNodes[block(start)])
+            {
+                int dist = startTree.dist[local(_nodes[next])];
+                if (dist >= 0)
+                {
+                    relax(node, next, dist, -1);
+                }
+            }
+            if (block(start) == block(goal) && startTree.dist[local(goal)] >= 0)
+            {
+                relax(node, goalNode, startTree.dist[local(goal)], -1);
+            }
+            continue;
+        }
+        for (size_t i = 0; i < _edges[node].size(); ++i)
+        {
+            relax(node, _edges[node][i].to, _edges[node][i].cost, i);
+        }
+        if (block(_nodes[node]) == block(goal) && goalTree.dist[local(_nodes[node])] >= 0)
+        {
+            relax(node, goalNode, goalTree.dist[local(_nodes[node])], -1);
+        }
+    }
+
+    if (g[goalNode] == inf)
+    {
+        // abstraction may lose connectivity, so we can not prove that path does not exist
+        solution.stats.pathVerdict = PATH_NOT_FOUND;
+    }
+    else
+    {
+        vector<uint32_t> path;
+        for (uint32_t node = goalNode; node != inf; node = parent[node])
+        {
+            path.push_back(node);
+        }
+        std::reverse(path.begin(), path.end());
+
+        // refine every edge of abstract path
+        vector<size_t> actions;
+        for (size_t i = 0; i + 1 < path.size(); ++i)
+        {
+            uint32_t from = path[i];
+            uint32_t to = path[i + 1];
+            vector<size_t> piece;
+            if (from == startNode)
+            {
+                piece = pathTo(startTree, to == goalNode ? goal : _nodes[to]);
+            }
+            else if (to == goalNode)
+            {
+                piece = pathFrom(goalTree, _nodes[from]);
+            }
+            else if (_edges[from][parentEdge[to]].action >= 0)
+            {
+                piece = {(size_t)_edges[from][parentEdge[to]].action};
+            }
+            else
+            {
+                piece = pathTo(searchBlock(_nodes[from], false), _nodes[to]);
+            }
+            actions.insert(actions.end(), piece.begin(), piece.end());
+        }
+        for (size_t action : actions)
+        {
+            solution.addAction(action);
+        }
+        solution.stats.pathVerdict = PATH_FOUND;
+        solution.stats.pathCost = actions.size();
+        solution.stats.pathPotentialCost = manhattanHeuristic(startPos, goalPos);
+    }
+    solution.stats.maxTreeSize = _nodes.size();
+    solution.stats.runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return solution;
+}
+
+size_t HierarchicalGraph::blockSize() const
+{
+    return _blockSize;
+}
+size_t HierarchicalGraph::nodes() const
+{
+    return _nodes.size();
+}
+size_t HierarchicalGraph::edges() const
+{
+    size_t result = 0;
+    for (const vector<Edge>& edges : _edges)
+    {
+        result += edges.size();
+    }
+    return result;
+}
+
+size_t HierarchicalGraph::block(size_t id) const
+{
+    size_t result = 0;
+    size_t factor = 1;
+    for (size_t i = 0; i < _lattice->dof(); ++i)
+    {
+        result += (id % (2 * g_units)) / _blockSize * factor;
+        id /= 2 * g_units;
+        factor *= _blocksInRow;
+    }
+    return result;
+}
+size_t HierarchicalGraph::local(size_t id) const
+{
+    size_t result = 0;
+    size_t factor = 1;
+    for (size_t i = 0; i < _lattice->dof(); ++i)
+    {
+        result += (id % (2 * g_units)) % _blockSize * factor;
+        id /= 2 * g_units;
+        factor *= _blockSize;
+    }
+    return result;
+}
+
+HierarchicalGraph::BlockTree HierarchicalGraph::searchBlock(size_t source, bool reverse) const
+{
+    BlockTree tree;
+    tree.dist.assign(_blockVolume, -1);
+    tree.action.assign(_blockVolume, -1);
+    size_t sourceBlock = block(source);
+
+    vector<size_t> queue = {source};
+    tree.dist[local(source)] = 0;
+    for (size_t head = 0; head < queue.size(); ++head)
+    {
+        size_t current = queue[head];
+        for (size_t a = 0; a < _lattice->actions(); ++a)
+        {
+            size_t next;
+            if (!reverse)
+            {
+                next = _lattice->hasEdge(current, a) ? _lattice->neighbour(current, a) : _lattice->size();
+            }
+            else
+            {
+                next = _lattice->neighbour(current, _lattice->reverseAction(a));
+                if (next != _lattice->size() && !_lattice->hasEdge(next, a))
+                {
+                    next = _lattice->size();
+                }
+            }
+            if (next == _lattice->size() || block(next) != sourceBlock || tree.dist[local(next)] >= 0)
+            {
+                continue;
+            }
+            tree.dist[local(next)] = tree.dist[local(current)] + 1;
+            tree.action[local(next)] = a;
+            queue.push_back(next);
+        }
+    }
+    return tree;
+}
+
+vector<size_t> HierarchicalGraph::pathTo(const BlockTree& tree, size_t target) const
+{
+    vector<size_t> actions;
+    while (tree.dist[local(target)] > 0)
+    {
+        size_t action = tree.action[local(target)];
+        actions.push_back(action);
+        target = _lattice->neighbour(target, _lattice->reverseAction(action));
+    }
+    std::reverse(actions.begin(), actions.end());
+    return actions;
+}
+vector<size_t> HierarchicalGraph::pathFrom(const BlockTree& tree, size_t state) const
+{
+    vector<size_t> actions;
+    while (tree.dist[local(state)] > 0)
+    {
+        size_t action = tree.action[local(state)];
+        actions.push_back(action);
+        state = _lattice->neighbour(state, action);
+    }
+    return actions;
+}
+
+void HierarchicalGraph::addEntrances()
+{
+    const size_t dof = _lattice->dof();
+    const size_t actions = _lattice->actions();
+
+    // free edges in both directions between different blocks, only positive actions
+    vector<std::pair<size_t, size_t>> crossings;
+    std::unordered_map<size_t, size_t> crossingOf;
+    for (size_t id = 0; id < _lattice->size(); ++id)
+    {
+        if (!_lattice->isFree(id))
+        {
+            continue;
+        }
+        for (size_t a = 0; a < dof; ++a)
+        {
+            size_t next = _lattice->neighbour(id, a);
+            if (next == _lattice->size() || block(next) == block(id))
+            {
+                continue;
+            }
+            if (_lattice->hasEdge(id, a) && _lattice->hasEdge(next, _lattice->reverseAction(a)))
+            {
+                crossingOf[id * actions + a] = crossings.size();
+                crossings.push_back({id, a});
+            }
+        }
+    }
+
+    // connected pieces of borders
+    vector<size_t> root(crossings.size());
+    std::iota(root.begin(), root.end(), 0);
+    std::function<size_t(size_t)> find = [&](size_t x)
+    {
+        return root[x] == x ? x : root[x] = find(root[x]);
+    };
+    for (size_t c = 0; c < crossings.size(); ++c)
+    {
+        size_t id = crossings[c].first;
+        size_t a = crossings[c].second;
+        for (size_t j = 0; j < dof; ++j)
+        {
+            size_t next = _lattice->neighbour(id, j);
+            if (j == a || next == _lattice->size() || block(next) != block(id) || !_lattice->hasEdge(id, j))
+            {
+                continue;
+            }
+            auto it = crossingOf.find(next * actions + a);
+            if (it != crossingOf.end())
+            {
+                root[find(c)] = find(it->second);
+            }
+        }
+    }
+    std::unordered_map<size_t, vector<size_t>> pieces;
+    for (size_t c = 0; c < crossings.size(); ++c)
+    {
+        pieces[find(c)].push_back(c);
+    }
+
+    auto addNode = [this](size_t id)
+    {
+        auto it = _nodeOf.find(id);
+        if (it != _nodeOf.end())
+        {
+            return it->second;
+        }
+        uint32_t node = _nodes.size();
+        _nodes.push_back(id);
+        _nodeOf[id] = node;
+        _edges.emplace_back();
+        _blockNodes[block(id)].push_back(node);
+        return node;
+    };
+    // keys of map are not ordered, so pieces are sorted to make result deterministic
+    vector<vector<size_t>> sortedPieces;
+    for (auto& piece : pieces)
+    {
+        sortedPieces.push_back(piece.second);
+    }
+    std::sort(sortedPieces.begin(), sortedPieces.end());
+    for (const vector<size_t>& piece : sortedPieces)
+    {
+        // the middle of piece is entrance
+        size_t id = crossings[piece[piece.size() / 2]].first;
+        size_t a = crossings[piece[piece.size() / 2]].second;
+        size_t next = _lattice->neighbour(id, a);
+        uint32_t from = addNode(id);
+        uint32_t to = addNode(next);
+        _edges[from].push_back({to, 1, (int32_t)a});
+        _edges[to].push_back({from, 1, (int32_t)_lattice->reverseAction(a)});
+    }
+}
+
+void HierarchicalGraph::addInnerEdges(size_t threads)
+{
+    auto work = [this, threads](size_t id)
+    {
+        for (size_t b = id; b < _blockNodes.size(); b += threads)
+        {
+            for (uint32_t from : _blockNodes[b])
+            {
+                BlockTree tree = searchBlock(_nodes[from], false);
+                for (uint32_t to : _blockNodes[b])
+                {
+                    int dist = tree.dist[local(_nodes[to])];
+                    if (to != from && dist > 0)
+                    {
+                        _edges[from].push_back({to, (uint32_t)dist, -1});
+                    }
+                }
+            }
+        }
+    };
+    vector<std::thread> workers;
+    for (size_t id = 0; id < threads; ++id)
+    {
+        workers.emplace_back(work, id);
+    }
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+std::shared_ptr<HierarchicalGraph> loadHierarchicalGraph(const ManipulatorPlanner& planner, const std::string& modelFilename)
+{
+    uint64_t hash = modelHash(planner.model());
+    std::shared_ptr<Lattice> lattice = std::make_shared<Lattice>(planner.dof());
+    lattice->load(precomputedFilename(modelFilename, "lattice"), hash);
+    return std::make_shared<HierarchicalGraph>(lattice, precomputedFilename(modelFilename, "hpa"), hash);
+}
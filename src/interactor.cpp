@@ -1,5 +1,12 @@
 #include "interactor.h"
 #include "global_defs.h"
+#include "hpa.h"
+#include "ch.h"
+#include "cpd.h"
+#include "components.h"
+#include "link_table.h"
+#include "roadmap.h"
+#include "rsr.h"
 
 #include <stdexcept>
 
@@ -11,6 +18,7 @@ Interactor::Interactor(const std::string& modelFilename)
         mju_error_s("Load model error: %s", error); // exception in constructor - bad idea TODO
     _data = mj_makeData(_model);
     _dof = _model->nq / 2;
+    _modelFilename = modelFilename;
 
     mjModel* mCopy = mj_copyModel(NULL, _model);
     mjData* dCopy = mj_makeData(mCopy);
@@ -26,6 +34,20 @@ Interactor::~Interactor()
     mjr_freeContext(&_con);
     mj_deleteData(_data);
     mj_deleteModel(_model);
+    if (_experience != nullptr)
+    {
+        // exception from destructor would terminate program, so failed save is only reported
+        try
+        {
+            _experience->save(_config.experienceFilename);
+        }
+        catch (const std::exception& e)
+        {
+            fprintf(stderr, "Could not save experience: %s\n", e.what());
+        }
+        delete _experience;
+    }
+    delete _smoother;
     delete _planner;
     delete _logger;
     delete _taskset;
@@ -69,6 +91,44 @@ void Interactor::setUp(Config config)
     _cam.lookat[2] = arr_view[5];
 
     _config = config;
+    if (_config.alg == ALG_HPA)
+    {
+        _planner->setHierarchicalGraph(loadHierarchicalGraph(*_planner, _modelFilename));
+    }
+    else if (_config.alg == ALG_CH)
+    {
+        _planner->setContractionHierarchy(loadContractionHierarchy(*_planner, _modelFilename));
+    }
+    else if (_config.alg == ALG_CPD)
+    {
+        _planner->setPathDatabase(loadPathDatabase(*_planner, _modelFilename));
+    }
+    else if (_config.alg == ALG_ROADMAP)
+    {
+        _planner->setRoadmap(loadRoadmap(*_planner, _modelFilename));
+    }
+    else if (_config.alg == ALG_RSR)
+    {
+        _planner->setSymmetryReduction(loadSymmetryReduction(*_planner, _modelFilename));
+    }
+    if (_config.useComponents)
+    {
+        _planner->setComponentMap(loadComponentMap(*_planner, _modelFilename));
+    }
+    if (_config.useLinkTable)
+    {
+        _planner->setLinkCollisionTable(loadLinkCollisionTable(*_planner, _modelFilename));
+    }
+    if (!_config.experienceFilename.empty())
+    {
+        _experience = new ExperienceCache(*_planner);
+        _experience->load(_config.experienceFilename);
+    }
+    // workers of smoother are copies of planner, so they are taken after precomputed data is set
+    if (_config.smoothPath)
+    {
+        _smoother = new PathSmoother(*_planner);
+    }
 
     _modelState.currentState = JointState(_dof, 0);
     _modelState.goal = JointState(_dof, 0);
@@ -164,25 +224,47 @@ void Interactor::solveTask()
     if (_modelState.counter > 8) // to first of all simulator can show picture
     {
         _modelState.counter = 0;
+        bool useExperience = _experience != nullptr && _config.alg == ALG_ASTAR;
         if (_modelState.task->type() == TASK_STATE)
         {
-            _modelState.solution = _planner->planActions(_modelState.currentState, _modelState.goal,
-                ALG_ASTAR, _config.timeLimit, _config.w);
-
-            _logger->printScenLog(_modelState.solution, _modelState.currentState, _modelState.goal);
+            _modelState.solution = useExperience ?
+                _experience->planActions(_modelState.currentState, _modelState.goal, _config.timeLimit, _config.w) :
+                _planner->planActions(_modelState.currentState, _modelState.goal,
+                _config.alg, _config.timeLimit, _config.w);
+        }
+        else if (_modelState.task->type() == TASK_POSITION && useExperience)
+        {
+            _modelState.solution = _experience->planActions(_modelState.currentState,
+                static_cast<const TaskPosition*>(_modelState.task)->goalX(),
+                static_cast<const TaskPosition*>(_modelState.task)->goalY(),
+                _config.timeLimit, _config.w);
         }
         else if (_modelState.task->type() == TASK_POSITION)
         {
             _modelState.solution = _planner->planActions(_modelState.currentState,
                 static_cast<const TaskPosition*>(_modelState.task)->goalX(),
                 static_cast<const TaskPosition*>(_modelState.task)->goalY(),
-                ALG_ASTAR, _config.timeLimit, _config.w);
+                needsGoalState(_config.alg) ? ALG_ASTAR : _config.alg,
+                _config.timeLimit, _config.w);
+        }
+        _modelState.haveToPlan = false;
 
-            _logger->printScenLog(_modelState.solution, _modelState.currentState, 
+        // logs describe the executed solution, so it is smoothed first
+        if (_config.smoothPath)
+        {
+            _modelState.solution = _smoother->smooth(_modelState.solution, _modelState.currentState);
+        }
+
+        if (_modelState.task->type() == TASK_STATE)
+        {
+            _logger->printScenLog(_modelState.solution, _modelState.currentState, _modelState.goal);
+        }
+        else if (_modelState.task->type() == TASK_POSITION)
+        {
+            _logger->printScenLog(_modelState.solution, _modelState.currentState,
                 static_cast<const TaskPosition*>(_modelState.task)->goalX(),
                 static_cast<const TaskPosition*>(_modelState.task)->goalY());
         }
-        _modelState.haveToPlan = false;
 
         _logger->printMainLog(_modelState.solution);
         
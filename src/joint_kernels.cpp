@@ -0,0 +1,207 @@
+#include "joint_kernels.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JOINT_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+static_assert(g_maxDof == 8, "SIMD kernels expect 8 int16 joints in one register");
+
+namespace
+{
+
+const JointValue* at(const JointValue* base, size_t stride, size_t k)
+{
+    return reinterpret_cast<const JointValue*>(reinterpret_cast<const char*>(base) + stride * k);
+}
+JointValue* at(JointValue* base, size_t stride, size_t k)
+{
+    return reinterpret_cast<JointValue*>(reinterpret_cast<char*>(base) + stride * k);
+}
+
+// scalar kernels
+
+uint32_t addBatchScalar(const JointValue* state, const JointValue* actions, size_t actionStride,
+    size_t count, JointValue* out, size_t outStride, const JointLimits& limits)
+{
+    uint32_t mask = 0;
+    for (size_t k = 0; k < count; ++k)
+    {
+        const JointValue* action = at(actions, actionStride, k);
+        JointValue* result = at(out, outStride, k);
+        bool correct = true;
+        for (size_t i = 0; i < g_maxDof; ++i)
+        {
+            int value = state[i] + action[i];
+            value += value >= g_units ? -limits.period[i] : (value < -g_units ? limits.period[i] : 0);
+            correct &= value >= limits.low[i] && value <= limits.high[i];
+            result[i] = value;
+        }
+        mask |= (uint32_t)correct << k;
+    }
+    return mask;
+}
+
+bool inLimitsScalar(const JointValue* joints, const JointLimits& limits)
+{
+    bool correct = true;
+    for (size_t i = 0; i < g_maxDof; ++i)
+    {
+        correct &= joints[i] >= limits.low[i] && joints[i] <= limits.high[i];
+    }
+    return correct;
+}
+
+int manhattanScalar(const JointValue* joints1, const JointValue* joints2, const JointLimits& limits)
+{
+    int dist = 0;
+    for (size_t i = 0; i < g_maxDof; ++i)
+    {
+        int d = std::abs(joints1[i] - joints2[i]);
+        dist += limits.period[i] != 0 ? std::min(d, limits.period[i] - d) : d;
+    }
+    return dist;
+}
+
+const JointKernels g_scalarKernels = {"scalar", addBatchScalar, inLimitsScalar, manhattanScalar};
+
+#ifdef JOINT_KERNELS_X86
+
+// SSE4.1 kernels, one state in register
+
+__attribute__((target("sse4.1")))
+__m128i load(const JointValue* joints)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(joints));
+}
+
+__attribute__((target("sse4.1")))
+__m128i normalizeSse(__m128i joints, __m128i period)
+{
+    const __m128i high = _mm_set1_epi16(g_units - 1);
+    const __m128i low = _mm_set1_epi16(-g_units);
+    joints = _mm_sub_epi16(joints, _mm_and_si128(_mm_cmpgt_epi16(joints, high), period));
+    return _mm_add_epi16(joints, _mm_and_si128(_mm_cmpgt_epi16(low, joints), period));
+}
+
+__attribute__((target("sse4.1")))
+bool inLimitsRegister(__m128i joints, __m128i low, __m128i high)
+{
+    __m128i wrong = _mm_or_si128(_mm_cmpgt_epi16(joints, high), _mm_cmpgt_epi16(low, joints));
+    return _mm_testz_si128(wrong, wrong);
+}
+
+__attribute__((target("sse4.1")))
+uint32_t addBatchSse(const JointValue* state, const JointValue* actions, size_t actionStride,
+    size_t count, JointValue* out, size_t outStride, const JointLimits& limits)
+{
+    __m128i base = load(state);
+    __m128i low = load(limits.low);
+    __m128i high = load(limits.high);
+    __m128i period = load(limits.period);
+    uint32_t mask = 0;
+    for (size_t k = 0; k < count; ++k)
+    {
+        __m128i result = normalizeSse(_mm_add_epi16(base, load(at(actions, actionStride, k))), period);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(at(out, outStride, k)), result);
+        mask |= (uint32_t)inLimitsRegister(result, low, high) << k;
+    }
+    return mask;
+}
+
+__attribute__((target("sse4.1")))
+bool inLimitsSse(const JointValue* joints, const JointLimits& limits)
+{
+    return inLimitsRegister(load(joints), load(limits.low), load(limits.high));
+}
+
+__attribute__((target("sse4.1")))
+int manhattanSse(const JointValue* joints1, const JointValue* joints2, const JointLimits& limits)
+{
+    __m128i period = load(limits.period);
+    __m128i dist = _mm_abs_epi16(_mm_sub_epi16(load(joints1), load(joints2)));
+    // cyclic joint may go the other way around
+    __m128i around = _mm_sub_epi16(period, dist);
+    __m128i cyclic = _mm_cmpgt_epi16(period, _mm_setzero_si128());
+    dist = _mm_min_epi16(dist, _mm_blendv_epi8(dist, around, cyclic));
+    __m128i sum = _mm_madd_epi16(dist, _mm_set1_epi16(1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+}
+
+const JointKernels g_sseKernels = {"sse4.1", addBatchSse, inLimitsSse, manhattanSse};
+
+// AVX2 kernels, two states in register
+
+__attribute__((target("avx2")))
+__m256i broadcast(const JointValue* joints)
+{
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(joints)));
+}
+
+__attribute__((target("avx2")))
+uint32_t addBatchAvx2(const JointValue* state, const JointValue* actions, size_t actionStride,
+    size_t count, JointValue* out, size_t outStride, const JointLimits& limits)
+{
+    const __m256i border = _mm256_set1_epi16(g_units - 1);
+    const __m256i negativeBorder = _mm256_set1_epi16(-g_units);
+    __m256i base = broadcast(state);
+    __m256i low = broadcast(limits.low);
+    __m256i high = broadcast(limits.high);
+    __m256i period = broadcast(limits.period);
+    uint32_t mask = 0;
+    size_t k = 0;
+    for (; k + 1 < count; k += 2)
+    {
+        __m128i action0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(at(actions, actionStride, k)));
+        __m128i action1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(at(actions, actionStride, k + 1)));
+        __m256i result = _mm256_add_epi16(base, _mm256_inserti128_si256(_mm256_castsi128_si256(action0), action1, 1));
+        result = _mm256_sub_epi16(result, _mm256_and_si256(_mm256_cmpgt_epi16(result, border), period));
+        result = _mm256_add_epi16(result, _mm256_and_si256(_mm256_cmpgt_epi16(negativeBorder, result), period));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(at(out, outStride, k)), _mm256_castsi256_si128(result));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(at(out, outStride, k + 1)), _mm256_extracti128_si256(result, 1));
+        __m256i wrong = _mm256_or_si256(_mm256_cmpgt_epi16(result, high), _mm256_cmpgt_epi16(low, result));
+        uint32_t bytes = _mm256_movemask_epi8(wrong);
+        mask |= (uint32_t)((bytes & 0xFFFF) == 0) << k;
+        mask |= (uint32_t)((bytes >> 16) == 0) << (k + 1);
+    }
+    if (k < count)
+    {
+        mask |= addBatchSse(state, at(actions, actionStride, k), actionStride, 1,
+            at(out, outStride, k), outStride, limits) << k;
+    }
+    return mask;
+}
+
+const JointKernels g_avx2Kernels = {"avx2", addBatchAvx2, inLimitsSse, manhattanSse};
+
+#endif
+
+} // namespace
+
+vector<const JointKernels*> supportedJointKernels()
+{
+    vector<const JointKernels*> result = {&g_scalarKernels};
+#ifdef JOINT_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.1"))
+    {
+        result.push_back(&g_sseKernels);
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        result.push_back(&g_avx2Kernels);
+    }
+#endif
+    return result;
+}
+
+const JointKernels& jointKernels()
+{
+    static const JointKernels& best = *supportedJointKernels().back();
+    return best;
+}
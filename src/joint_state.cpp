@@ -1,7 +1,26 @@
 #include "joint_state.h"
+#include "joint_kernels.h"
 
 #include <algorithm>
 #include <stdexcept>
+#include <string>
+
+JointLimits::JointLimits()
+{
+    for (size_t i = 0; i < g_maxDof; ++i)
+    {
+        low[i] = -g_units;
+        high[i] = g_units - 1;
+        period[i] = i == 0 ? 2 * g_units : 0;
+        step[i] = 1;
+    }
+}
+
+const JointLimits& defaultJointLimits()
+{
+    static const JointLimits limits;
+    return limits;
+}
 
 // return n % (2 * mod) in [-mod, mod)
 int trueMod(int n, int mod)
@@ -24,13 +43,21 @@ int trueMod(int n, int mod)
 
 Action::Action(size_t dof, int value)
 {
+    if (dof > g_maxDof)
+    {
+        throw std::runtime_error("Action: dof is greater than g_maxDof");
+    }
     _dof = dof;
-    _joints.assign(_dof, value);
+    std::fill(_joints, _joints + _dof, value);
 }
 Action::Action(std::initializer_list<int> list)
 {
-    _joints.assign(list);
-    _dof = _joints.size();
+    if (list.size() > g_maxDof)
+    {
+        throw std::runtime_error("Action: dof is greater than g_maxDof");
+    }
+    _dof = list.size();
+    std::copy(list.begin(), list.end(), _joints);
 }
 
 size_t Action::dof() const
@@ -42,16 +69,21 @@ int Action::operator[](size_t i) const
     // TODO
     return _joints[i];
 }
-int& Action::operator[](size_t i)
+JointValue& Action::operator[](size_t i)
 {
     // TODO
     return _joints[i];
 }
 
+const JointValue* Action::data() const
+{
+    return _joints;
+}
+
 int Action::abs() const
 {
     int len = 0;
-    for (size_t i = 0; i < dof(); ++i)
+    for (size_t i = 0; i < g_maxDof; ++i)
     {
         len += std::abs(_joints[i]); // It is integer abs
     }
@@ -61,14 +93,22 @@ int Action::abs() const
 
 JointState::JointState(size_t dof, int value)
 {
+    if (dof > g_maxDof)
+    {
+        throw std::runtime_error("JointState: dof is greater than g_maxDof");
+    }
     _dof = dof;
-    _joints.assign(_dof, value);
+    std::fill(_joints, _joints + _dof, value);
     normalize();
 }
 JointState::JointState(std::initializer_list<int> list)
 {
-    _joints.assign(list);
-    _dof = _joints.size();
+    if (list.size() > g_maxDof)
+    {
+        throw std::runtime_error("JointState: dof is greater than g_maxDof");
+    }
+    _dof = list.size();
+    std::copy(list.begin(), list.end(), _joints);
     normalize();
 }
 
@@ -77,13 +117,18 @@ int JointState::operator[](size_t i) const
     // TODO
     return _joints[i];
 }
-int& JointState::operator[](size_t i)
+JointValue& JointState::operator[](size_t i)
 {
     _hasCacheXY = false;
     // TODO
     return _joints[i];
 }
 
+const JointValue* JointState::data() const
+{
+    return _joints;
+}
+
 JointState& JointState::apply(const Action& action)
 {
     _hasCacheXY = false;
@@ -91,9 +136,9 @@ JointState& JointState::apply(const Action& action)
     {
         throw std::runtime_error("JointState::apply: dofs of operands are not equal");
     }
-    for (size_t i = 0; i < _dof; ++i)
+    for (size_t i = 0; i < g_maxDof; ++i)
     {
-        _joints[i] += action[i];
+        _joints[i] += action._joints[i];
     }
     _lastAction = &action;
     normalize();
@@ -105,17 +150,11 @@ JointState JointState::applied(const Action& action) const
     return result.apply(action);
 }
 
-JointState& JointState::operator=(const JointState& other)
+JointState JointState::withoutLastAction() const
 {
-    _hasCacheXY = false;
-    _dof = other._dof;
-    _joints.resize(_dof);
-    for (size_t i = 0; i < _dof; ++i)
-    {
-        _joints[i] = other._joints[i];
-    }
-    normalize();
-    return *this;
+    JointState result = *this;
+    result._lastAction = nullptr;
+    return result;
 }
 
 bool operator<(const JointState& state1, const JointState& state2)
@@ -124,7 +163,8 @@ bool operator<(const JointState& state1, const JointState& state2)
     {
         return state1._dof < state2._dof;
     }
-    return state1._joints < state2._joints;
+    return std::lexicographical_compare(state1._joints, state1._joints + state1._dof,
+        state2._joints, state2._joints + state2._dof);
 }
 bool operator>(const JointState& state1, const JointState& state2)
 {
@@ -144,7 +184,7 @@ bool operator==(const JointState& state1, const JointState& state2)
     {
         return false;
     }
-    return state1._joints == state2._joints;
+    return std::equal(state1._joints, state1._joints + g_maxDof, state2._joints);
 }
 bool operator!=(const JointState& state1, const JointState& state2)
 {
@@ -168,11 +208,11 @@ const Action* JointState::lastAction() const
 
 int JointState::maxJoint() const
 {
-    return *std::max_element(_joints.begin(), _joints.end());
+    return *std::max_element(_joints, _joints + _dof);
 }
 int JointState::minJoint() const
 {
-    return *std::min_element(_joints.begin(), _joints.end());
+    return *std::min_element(_joints, _joints + _dof);
 }
 
 int JointState::abs() const
@@ -187,31 +227,27 @@ int JointState::abs() const
 
 bool JointState::isCorrect() const
 {
-    return minJoint() >= -g_units && maxJoint() < g_units;
+    return jointKernels().inLimits(_joints, defaultJointLimits());
+}
+bool JointState::isCorrect(const JointLimits& limits) const
+{
+    return jointKernels().inLimits(_joints, limits);
 }
 
 int manhattanDistance(const JointState& state1, const JointState& state2)
 {
-    int dist = 0;
-    for (size_t i = 0; i < state1.dof(); ++i)
-    {
-        if (i == 0)
-        {
-            dist += std::min(abs(state1[i] - state2[i]), 2 * g_units - abs(state1[i] - state2[i]));
-        }
-        else
-        {
-            dist += abs(state1[i] - state2[i]);
-        }
-    }
-    return dist;
+    return jointKernels().manhattan(state1._joints, state2._joints, defaultJointLimits());
+}
+int manhattanDistance(const JointState& state1, const JointState& state2, const JointLimits& limits)
+{
+    return jointKernels().manhattan(state1._joints, state2._joints, limits);
 }
 int manhattanDistance(const Action& action1, const Action& action2)
 {
     int dist = 0;
-    for (size_t i = 0; i < action1.dof(); ++i)
+    for (size_t i = 0; i < g_maxDof; ++i)
     {
-        dist += abs(action1[i] - action2[i]);
+        dist += abs(action1._joints[i] - action2._joints[i]);
     }
     return dist;
 }
@@ -221,6 +257,60 @@ CostType manhattanHeuristic(const JointState& state1, const JointState& state2)
     return manhattanDistance(state1, state2);
 }
 
+uint32_t appliedBatch(const JointState& state, const Action* actions, size_t count, JointState* successors,
+    const JointLimits& limits)
+{
+    for (size_t k = 0; k < count; ++k)
+    {
+        if (actions[k]._dof != state._dof)
+        {
+            throw std::runtime_error("appliedBatch: dofs of operands are not equal");
+        }
+        successors[k]._dof = state._dof;
+        successors[k]._lastAction = &actions[k];
+        successors[k]._hasCacheXY = false;
+    }
+    return jointKernels().addBatch(state._joints, actions[0]._joints, sizeof(Action), count,
+        successors[0]._joints, sizeof(JointState), limits);
+}
+
+Action difference(const JointState& start, const JointState& goal)
+{
+    Action diff(start.dof(), 0);
+    for (size_t i = 0; i < start.dof(); ++i)
+    {
+        diff[i] = goal[i] - start[i];
+    }
+    diff[0] = trueMod(diff[0], g_units);
+    return diff;
+}
+
+vector<Action> lineActions(const JointState& start, const JointState& goal)
+{
+    Action diff = difference(start, goal);
+    int steps = 0;
+    for (size_t i = 0; i < diff.dof(); ++i)
+    {
+        steps = std::max(steps, std::abs(diff[i]));
+    }
+
+    vector<Action> result(steps, Action(diff.dof(), 0));
+    for (size_t i = 0; i < diff.dof(); ++i)
+    {
+        int sign = diff[i] < 0 ? -1 : 1;
+        int len = std::abs(diff[i]);
+        int prev = 0;
+        for (int k = 1; k <= steps; ++k)
+        {
+            // rounded len * k / steps
+            int cur = (2 * len * k + steps) / (2 * steps);
+            result[k - 1][i] = sign * (cur - prev);
+            prev = cur;
+        }
+    }
+    return result;
+}
+
 bool JointState::hasCacheXY() const
 {
     return _hasCacheXY;
@@ -245,12 +335,56 @@ void JointState::normalize()
     _joints[0] = trueMod(_joints[0], g_units);
 }
 
-JointState randomState(size_t dof, int units)
+JointState randomState(Random& random, size_t dof, const JointLimits& limits)
+{
+    JointState state(dof);
+    randomStates(random, dof, 1, &state, limits);
+    return state;
+}
+
+void randomStates(Random& random, size_t dof, size_t count, JointState* states, const JointLimits& limits)
+{
+    // joint i takes values first[i] + step[i] * k for k in [0, steps[i]], -g_units is multiple of step
+    int first[g_maxDof];
+    int steps[g_maxDof];
+    for (size_t i = 0; i < dof && i < g_maxDof; ++i)
+    {
+        int step = limits.step[i];
+        first[i] = (limits.low[i] + g_units + step - 1) / step * step - g_units;
+        if (first[i] > limits.high[i])
+        {
+            throw std::runtime_error("randomStates: range of joint " + std::to_string(i) + " has no multiple of its step");
+        }
+        steps[i] = (limits.high[i] - first[i]) / step;
+    }
+    for (size_t k = 0; k < count; ++k)
+    {
+        states[k] = JointState(dof);
+        for (size_t i = 0; i < dof; ++i)
+        {
+            states[k][i] = first[i] + limits.step[i] * random.uniform(0, steps[i]);
+        }
+    }
+}
+
+uint64_t JointState::toKey() const
+{
+    const uint64_t mask = (1ull << g_keyBits) - 1;
+    uint64_t key = 0;
+    for (size_t i = 0; i < _dof; ++i)
+    {
+        int value = i == 0 ? trueMod(_joints[0], g_units) : _joints[i];
+        key |= ((uint64_t)(value + g_units) & mask) << (g_keyBits * i);
+    }
+    return key;
+}
+JointState JointState::fromKey(uint64_t key, size_t dof)
 {
+    const uint64_t mask = (1ull << g_keyBits) - 1;
     JointState state(dof);
     for (size_t i = 0; i < dof; ++i)
     {
-        state[i] = rand() % (units * 2) - units;
+        state._joints[i] = (int)((key >> (g_keyBits * i)) & mask) - g_units;
     }
     return state;
 }
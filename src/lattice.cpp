@@ -0,0 +1,298 @@
+#include "lattice.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+
+const uint32_t g_precomputedVersion = 1;
+const uint16_t g_freeBit = 1 << 15;
+const size_t g_kindSize = 8; // bytes of kind in header of precomputed file
+
+// kind padded by zeros, longer kinds would be truncated silently, so they are rejected
+void kindName(const std::string& kind, char (&name)[g_kindSize])
+{
+    if (kind.size() > g_kindSize)
+    {
+        throw std::runtime_error("precomputed header: kind " + kind + " is longer than 8 characters");
+    }
+    memset(name, 0, g_kindSize);
+    memcpy(name, kind.data(), kind.size());
+}
+
+// FNV-1a
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+template<typename T>
+uint64_t hashArray(uint64_t hash, const T* data, size_t size)
+{
+    return hashBytes(hash, data, sizeof(T) * size);
+}
+
+} // namespace
+
+uint64_t modelHash(const mjModel* model)
+{
+    uint64_t hash = 14695981039346656037ull;
+    int constants[] = {g_units, g_unitSize, model->nq, model->ngeom, model->nbody, model->njnt, model->npair};
+    hash = hashArray(hash, constants, sizeof(constants) / sizeof(int));
+    hash = hashArray(hash, model->geom_type, model->ngeom);
+    hash = hashArray(hash, model->geom_bodyid, model->ngeom);
+    hash = hashArray(hash, model->geom_size, 3 * model->ngeom);
+    hash = hashArray(hash, model->geom_pos, 3 * model->ngeom);
+    hash = hashArray(hash, model->geom_quat, 4 * model->ngeom);
+    hash = hashArray(hash, model->body_parentid, model->nbody);
+    hash = hashArray(hash, model->body_pos, 3 * model->nbody);
+    hash = hashArray(hash, model->body_quat, 4 * model->nbody);
+    hash = hashArray(hash, model->jnt_type, model->njnt);
+    hash = hashArray(hash, model->jnt_pos, 3 * model->njnt);
+    hash = hashArray(hash, model->jnt_axis, 3 * model->njnt);
+    hash = hashArray(hash, model->jnt_limited, model->njnt);
+    hash = hashArray(hash, model->jnt_range, 2 * model->njnt);
+    hash = hashArray(hash, model->pair_geom1, model->npair);
+    hash = hashArray(hash, model->pair_geom2, model->npair);
+    hash = hashArray(hash, model->pair_margin, model->npair);
+    return hash;
+}
+
+std::string precomputedFilename(const std::string& modelFilename, const std::string& kind)
+{
+    size_t dot = modelFilename.find_last_of('.');
+    size_t slash = modelFilename.find_last_of('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+    {
+        return modelFilename + "." + kind;
+    }
+    return modelFilename.substr(0, dot) + "." + kind;
+}
+
+void writePrecomputedHeader(FILE* file, const std::string& kind, uint64_t hash, size_t dof)
+{
+    char name[g_kindSize];
+    kindName(kind, name);
+    uint32_t numbers[] = {g_precomputedVersion, (uint32_t)dof, (uint32_t)g_units};
+    fwrite(name, sizeof(name), 1, file);
+    fwrite(&hash, sizeof(hash), 1, file);
+    fwrite(numbers, sizeof(numbers), 1, file);
+}
+void readPrecomputedHeader(FILE* file, const std::string& kind, uint64_t hash, size_t dof)
+{
+    char name[g_kindSize] = {};
+    char expectedName[g_kindSize];
+    kindName(kind, expectedName);
+    uint64_t fileHash = 0;
+    uint32_t numbers[3] = {};
+    if (fread(name, sizeof(name), 1, file) != 1 || fread(&fileHash, sizeof(fileHash), 1, file) != 1 ||
+        fread(numbers, sizeof(numbers), 1, file) != 1)
+    {
+        throw std::runtime_error("readPrecomputedHeader: file is too short");
+    }
+    if (memcmp(name, expectedName, sizeof(name)) != 0)
+    {
+        throw std::runtime_error("readPrecomputedHeader: file does not contain " + kind);
+    }
+    if (numbers[0] != g_precomputedVersion)
+    {
+        throw std::runtime_error("readPrecomputedHeader: unsupported version of file");
+    }
+    if (fileHash != hash || numbers[1] != dof || numbers[2] != g_units)
+    {
+        throw std::runtime_error("readPrecomputedHeader: file was built for another model");
+    }
+}
+
+// Lattice
+
+Lattice::Lattice(size_t dof)
+{
+    if (dof == 0 || dof > 3)
+    {
+        throw std::runtime_error("Lattice: only dof from 1 to 3 is supported");
+    }
+    _dof = dof;
+    _size = 1;
+    for (size_t i = 0; i < _dof; ++i)
+    {
+        _strides.push_back(_size);
+        _size *= 2 * g_units;
+    }
+    _actions.assign(2 * _dof, Action(_dof, 0));
+    for (size_t i = 0; i < _dof; ++i)
+    {
+        _actions[i][i] = 1;
+        _actions[i + _dof][i] = -1;
+    }
+}
+
+void Lattice::build(const ManipulatorPlanner& planner, size_t threads)
+{
+    if (planner.dof() != _dof)
+    {
+        throw std::runtime_error("Lattice::build: dofs of planner and lattice are not equal");
+    }
+    for (size_t i = 0; i < _dof; ++i)
+    {
+        if (planner.limits().step[i] != 1)
+        {
+            throw std::runtime_error("Lattice::build: lattice supports only joints with step 1");
+        }
+    }
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    _masks.assign(_size, 0);
+
+    auto work = [this, threads](const ManipulatorPlanner* checker, size_t id)
+    {
+        size_t begin = _size * id / threads;
+        size_t end = _size * (id + 1) / threads;
+        for (size_t i = begin; i < end; ++i)
+        {
+            JointState current = state(i);
+            if (!checker->isCorrect(current) || checker->checkCollision(current))
+            {
+                continue;
+            }
+            uint16_t mask = g_freeBit;
+            for (size_t a = 0; a < _actions.size(); ++a)
+            {
+                if (checker->isCorrect(current, _actions[a]) && !checker->checkCollisionAction(current, _actions[a]))
+                {
+                    mask |= 1 << a;
+                }
+            }
+            _masks[i] = mask;
+        }
+    };
+    vector<std::unique_ptr<ManipulatorPlanner>> checkers;
+    vector<std::thread> workers;
+    for (size_t id = 0; id < threads; ++id)
+    {
+        checkers.push_back(std::make_unique<ManipulatorPlanner>(planner));
+    }
+    for (size_t id = 0; id < threads; ++id)
+    {
+        workers.emplace_back(work, checkers[id].get(), id);
+    }
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+size_t Lattice::dof() const
+{
+    return _dof;
+}
+size_t Lattice::size() const
+{
+    return _size;
+}
+size_t Lattice::actions() const
+{
+    return _actions.size();
+}
+const Action& Lattice::action(size_t actionId) const
+{
+    return _actions[actionId];
+}
+size_t Lattice::reverseAction(size_t actionId) const
+{
+    return actionId < _dof ? actionId + _dof : actionId - _dof;
+}
+
+size_t Lattice::index(const JointState& state) const
+{
+    size_t id = 0;
+    for (size_t i = 0; i < _dof; ++i)
+    {
+        id += (state[i] + g_units) * _strides[i];
+    }
+    return id;
+}
+JointState Lattice::state(size_t id) const
+{
+    JointState result(_dof, 0);
+    for (size_t i = 0; i < _dof; ++i)
+    {
+        result[i] = (int)(id / _strides[i] % (2 * g_units)) - g_units;
+    }
+    return result;
+}
+size_t Lattice::neighbour(size_t id, size_t actionId) const
+{
+    size_t joint = actionId % _dof;
+    int value = (int)(id / _strides[joint] % (2 * g_units)) + (actionId < _dof ? 1 : -1);
+    if (joint == 0)
+    {
+        // joint 0 is cyclic
+        value = (value + 2 * g_units) % (2 * g_units);
+    }
+    else if (value < 0 || value >= 2 * g_units)
+    {
+        return _size;
+    }
+    return id + (value - (int)(id / _strides[joint] % (2 * g_units))) * (long long)_strides[joint];
+}
+
+bool Lattice::isFree(size_t id) const
+{
+    return _masks[id] & g_freeBit;
+}
+bool Lattice::hasEdge(size_t id, size_t actionId) const
+{
+    return _masks[id] & (1 << actionId);
+}
+uint16_t Lattice::edgeMask(size_t id) const
+{
+    return _masks[id] & ~g_freeBit;
+}
+
+void Lattice::save(const std::string& filename, uint64_t hash) const
+{
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("Lattice::save: Could not open file " + filename);
+    }
+    writePrecomputedHeader(file, "lattice", hash, _dof);
+    fwrite(_masks.data(), sizeof(uint16_t), _masks.size(), file);
+    fclose(file);
+}
+void Lattice::load(const std::string& filename, uint64_t hash)
+{
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("Lattice::load: Could not open file " + filename);
+    }
+    try
+    {
+        readPrecomputedHeader(file, "lattice", hash, _dof);
+    }
+    catch (...)
+    {
+        fclose(file);
+        throw;
+    }
+    _masks.resize(_size);
+    size_t read = fread(_masks.data(), sizeof(uint16_t), _masks.size(), file);
+    fclose(file);
+    if (read != _size)
+    {
+        throw std::runtime_error("Lattice::load: file " + filename + " is too short");
+    }
+}
@@ -1,5 +1,8 @@
 #include "light_mujoco.h"
 
+#include <algorithm>
+#include <cmath>
+
 /*
 This code is copied out from src mujoco and refactoring to be
 faster in collision checks which we need. Use this code only
@@ -92,11 +95,8 @@ bool mj_light_collideGeoms(const mjModel* m, mjData* d, int g1, int g2) {
     return num;
 }
 
-// use only for predefined format
-bool mj_light_collision(mjModel* m, mjData* d)
+bool mj_light_collidePairs(const mjModel* m, mjData* d)
 {
-    mj_kinematics(m, d);
-
     for (int pairadr = 0; pairadr < m->npair; pairadr++)
     {
         if (mj_light_collideGeoms(m, d, pairadr, -1))
@@ -106,3 +106,247 @@ bool mj_light_collision(mjModel* m, mjData* d)
     }
     return false;
 }
+
+// use only for predefined format
+bool mj_light_collision(mjModel* m, mjData* d)
+{
+    mj_kinematics(m, d);
+    return mj_light_collidePairs(m, d);
+}
+
+namespace
+{
+
+const int g_turn = 2 * g_worldUnits; // world units in full turn
+static_assert((g_turn & (g_turn - 1)) == 0, "angle is taken modulo full turn by mask");
+
+// cos and sin of every angle of world lattice
+struct TrigTable
+{
+    TrigTable()
+    {
+        for (int a = 0; a < g_turn; ++a)
+        {
+            cos[a] = std::cos(a * g_worldEps);
+            sin[a] = std::sin(a * g_worldEps);
+        }
+    }
+
+    mjtNum cos[g_turn];
+    mjtNum sin[g_turn];
+};
+
+const TrigTable& trigTable()
+{
+    static const TrigTable table;
+    return table;
+}
+
+// frame of body of chain (geom or site) at zero angles
+template <class Frame>
+void initFrame(Frame& frame, int id, size_t link, const mjtNum* pos, const mjtNum* mat, const mjtNum* anchor)
+{
+    frame.id = id;
+    frame.link = link;
+    for (int i = 0; i < 3; ++i)
+    {
+        frame.offset[i] = pos[i] - anchor[i];
+    }
+    if (mat != nullptr)
+    {
+        std::copy(mat, mat + 9, frame.mat);
+    }
+}
+
+} // namespace
+
+PlanarChain::PlanarChain(const mjModel* m, mjData* d, size_t dof)
+{
+    if (m == nullptr || d == nullptr || dof == 0 || dof > (size_t)m->njnt || dof > g_maxDof)
+    {
+        return;
+    }
+    // static geoms are never updated by the chain
+    mj_kinematics(m, d);
+    mjData* zero = mj_makeData(m);
+    for (size_t k = 0; k < dof; ++k)
+    {
+        zero->qpos[m->jnt_qposadr[k]] = 0;
+    }
+    mj_kinematics(m, zero);
+
+    const mjtNum eps = 1e-9;
+    std::vector<int> linkOf(m->nbody, -1);
+    _supported = true;
+    for (size_t k = 0; k < dof && _supported; ++k)
+    {
+        int body = m->jnt_bodyid[k];
+        int parent = m->body_parentid[body];
+        const mjtNum* axis = zero->xaxis + 3 * k;
+        _supported = m->jnt_type[k] == mjJNT_HINGE && m->body_jntnum[body] == 1 &&
+            (k == 0 ? m->body_weldid[parent] == 0 : linkOf[parent] == (int)k - 1) &&
+            std::abs(axis[0]) < eps && std::abs(axis[1]) < eps;
+        linkOf[body] = k;
+
+        Link link;
+        link.sign = axis[2] > 0 ? 1 : -1;
+        for (int i = 0; i < 3; ++i)
+        {
+            link.anchor[i] = zero->xanchor[3 * k + i] - (k > 0 ? zero->xanchor[3 * (k - 1) + i] : 0);
+        }
+        _links.push_back(link);
+    }
+
+    // link of chain which moves body, -1 for static bodies and -2 for bodies moved by other joints
+    auto owner = [m, &linkOf](int body)
+    {
+        int root = body;
+        while (root != 0 && linkOf[root] < 0 && m->body_jntnum[root] == 0)
+        {
+            root = m->body_parentid[root];
+        }
+        if (root != 0 && linkOf[root] >= 0)
+        {
+            return linkOf[root];
+        }
+        return m->body_weldid[body] == 0 ? -1 : -2;
+    };
+    // geoms of bodies which move by other joints must not collide
+    std::vector<bool> moving(m->ngeom, false);
+    for (int g = 0; g < m->ngeom && _supported; ++g)
+    {
+        int link = owner(m->geom_bodyid[g]);
+        if (link >= 0)
+        {
+            _geoms.emplace_back();
+            initFrame(_geoms.back(), g, link, zero->geom_xpos + 3 * g, zero->geom_xmat + 9 * g, zero->xanchor + 3 * link);
+        }
+        moving[g] = link == -2;
+    }
+    for (int pair = 0; pair < m->npair && _supported; ++pair)
+    {
+        _supported = !moving[m->pair_geom1[pair]] && !moving[m->pair_geom2[pair]];
+    }
+    // pair belongs to the last link of its geoms, pairs of static geoms belong to link 0
+    std::vector<int> pairLink(m->npair, 0);
+    for (const Frame& geom : _geoms)
+    {
+        for (int pair = 0; pair < m->npair; ++pair)
+        {
+            if (m->pair_geom1[pair] == geom.id || m->pair_geom2[pair] == geom.id)
+            {
+                pairLink[pair] = std::max(pairLink[pair], (int)geom.link);
+            }
+        }
+    }
+    for (int pair = 0; pair < m->npair; ++pair)
+    {
+        _pairs.push_back(pair);
+    }
+    std::stable_sort(_pairs.begin(), _pairs.end(),
+        [&pairLink](int pair1, int pair2) { return pairLink[pair1] < pairLink[pair2]; });
+    _sitesSupported = _supported;
+    for (int s = 0; s < m->nsite && _sitesSupported; ++s)
+    {
+        int link = owner(m->site_bodyid[s]);
+        if (link >= 0)
+        {
+            _sites.emplace_back();
+            initFrame(_sites.back(), s, link, zero->site_xpos + 3 * s, nullptr, zero->xanchor + 3 * link);
+        }
+        _sitesSupported = link != -2;
+    }
+    auto byLink = [](const Frame& frame1, const Frame& frame2) { return frame1.link < frame2.link; };
+    std::stable_sort(_geoms.begin(), _geoms.end(), byLink);
+    std::stable_sort(_sites.begin(), _sites.end(), byLink);
+    for (size_t k = 0; k <= _links.size(); ++k)
+    {
+        auto before = [k](const Frame& frame) { return frame.link < k; };
+        _geomBegin.push_back(std::partition_point(_geoms.begin(), _geoms.end(), before) - _geoms.begin());
+        _siteBegin.push_back(std::partition_point(_sites.begin(), _sites.end(), before) - _sites.begin());
+        _pairBegin.push_back(std::partition_point(_pairs.begin(), _pairs.end(),
+            [k, &pairLink](int pair) { return pairLink[pair] < (int)k; }) - _pairs.begin());
+    }
+    _poses.resize(_links.size());
+    mj_deleteData(zero);
+}
+
+bool PlanarChain::supported() const
+{
+    return _supported;
+}
+
+bool PlanarChain::sitesSupported() const
+{
+    return _sitesSupported;
+}
+
+size_t PlanarChain::links() const
+{
+    return _links.size();
+}
+
+void PlanarChain::kinematics(mjData* d, const int* angles, size_t from) const
+{
+    const TrigTable& trig = trigTable();
+    mjtNum anchor[3] = {0, 0, 0};
+    int angle = 0;
+    if (from > 0)
+    {
+        std::copy(_poses[from - 1].anchor, _poses[from - 1].anchor + 3, anchor);
+        angle = _poses[from - 1].angle;
+    }
+    mjtNum c = trig.cos[angle];
+    mjtNum s = trig.sin[angle];
+    for (size_t k = from; k < _links.size(); ++k)
+    {
+        // anchor of joint k is moved by joints before it
+        const Link& link = _links[k];
+        anchor[0] += c * link.anchor[0] - s * link.anchor[1];
+        anchor[1] += s * link.anchor[0] + c * link.anchor[1];
+        anchor[2] += link.anchor[2];
+        angle = (angle + link.sign * angles[k]) & (g_turn - 1);
+        c = trig.cos[angle];
+        s = trig.sin[angle];
+        std::copy(anchor, anchor + 3, _poses[k].anchor);
+        _poses[k].angle = angle;
+        for (size_t g = _geomBegin[k]; g < _geomBegin[k + 1]; ++g)
+        {
+            const Frame& geom = _geoms[g];
+            mjtNum* pos = d->geom_xpos + 3 * geom.id;
+            mjtNum* mat = d->geom_xmat + 9 * geom.id;
+            pos[0] = anchor[0] + c * geom.offset[0] - s * geom.offset[1];
+            pos[1] = anchor[1] + s * geom.offset[0] + c * geom.offset[1];
+            pos[2] = anchor[2] + geom.offset[2];
+            for (int j = 0; j < 3; ++j)
+            {
+                mat[j] = c * geom.mat[j] - s * geom.mat[3 + j];
+                mat[3 + j] = s * geom.mat[j] + c * geom.mat[3 + j];
+                mat[6 + j] = geom.mat[6 + j];
+            }
+        }
+        for (size_t site = _siteBegin[k]; site < _siteBegin[k + 1]; ++site)
+        {
+            const Frame& frame = _sites[site];
+            mjtNum* pos = d->site_xpos + 3 * frame.id;
+            pos[0] = anchor[0] + c * frame.offset[0] - s * frame.offset[1];
+            pos[1] = anchor[1] + s * frame.offset[0] + c * frame.offset[1];
+            pos[2] = anchor[2] + frame.offset[2];
+        }
+    }
+}
+
+size_t PlanarChain::collidingLink(const mjModel* m, mjData* d, size_t from, size_t to) const
+{
+    for (size_t k = from; k < to; ++k)
+    {
+        for (size_t i = _pairBegin[k]; i < _pairBegin[k + 1]; ++i)
+        {
+            if (mj_light_collideGeoms(m, d, _pairs[i], -1))
+            {
+                return k;
+            }
+        }
+    }
+    return _links.size();
+}
@@ -0,0 +1,185 @@
+#include "link_table.h"
+#include "lattice.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+
+const size_t g_values = 2 * g_units; // values of one joint, power of two
+
+// index of values of joints 0..links-1, the last joint is the lowest digit,
+// the same angles modulo full turn have the same index
+size_t prefixIndex(const JointState& state, size_t links)
+{
+    size_t id = 0;
+    for (size_t i = 0; i < links; ++i)
+    {
+        id = id * g_values + ((state[i] + g_units) & (g_values - 1));
+    }
+    return id;
+}
+
+size_t tableWords(size_t link)
+{
+    size_t bits = g_values;
+    for (size_t i = 0; i < link; ++i)
+    {
+        bits *= g_values;
+    }
+    return bits / 64;
+}
+
+} // namespace
+
+LinkCollisionTable::LinkCollisionTable(const ManipulatorPlanner& planner, size_t links, size_t threads)
+{
+    _dof = planner.dof();
+    const mjModel* model = planner.model();
+    if (links == 0 || links > std::min(_dof, maxLinks))
+    {
+        throw std::runtime_error("LinkCollisionTable: links must be from 1 to min(dof, 3)");
+    }
+    mjData* data = model == nullptr ? nullptr : mj_makeData(model);
+    bool supported = PlanarChain(model, data, _dof).supported();
+    if (data != nullptr)
+    {
+        mj_deleteData(data);
+    }
+    if (!supported)
+    {
+        throw std::runtime_error("LinkCollisionTable: model is not a supported planar chain");
+    }
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    _bits.resize(links);
+    for (size_t k = 0; k < links; ++k)
+    {
+        _bits[k].assign(tableWords(k), 0);
+        // prefixes of joints 0..k-1 are split between threads, every prefix fills its own words
+        size_t prefixes = tableWords(k) * 64 / g_values;
+        auto fill = [this, k, threads, prefixes, model](size_t id)
+        {
+            mjData* data = mj_makeData(model);
+            PlanarChain chain(model, data, _dof);
+            int angles[g_maxDof] = {};
+            for (size_t prefix = prefixes * id / threads; prefix < prefixes * (id + 1) / threads; ++prefix)
+            {
+                size_t rest = prefix;
+                for (size_t i = k; i-- > 0;)
+                {
+                    angles[i] = ((int)(rest % g_values) - g_units) * g_unitSize;
+                    rest /= g_values;
+                }
+                angles[k] = -g_units * g_unitSize;
+                chain.kinematics(data, angles);
+                for (size_t value = 0; value < g_values; ++value)
+                {
+                    angles[k] = ((int)value - g_units) * g_unitSize;
+                    chain.kinematics(data, angles, k);
+                    if (chain.collidingLink(model, data, k, k + 1) == k)
+                    {
+                        size_t bit = prefix * g_values + value;
+                        _bits[k][bit / 64] |= 1ull << (bit % 64);
+                    }
+                }
+            }
+            mj_deleteData(data);
+        };
+        vector<std::thread> workers;
+        for (size_t id = 0; id < threads; ++id)
+        {
+            workers.emplace_back(fill, id);
+        }
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+}
+
+LinkCollisionTable::LinkCollisionTable(size_t dof, const std::string& filename, uint64_t hash)
+{
+    _dof = dof;
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("LinkCollisionTable: Could not open file " + filename);
+    }
+    try
+    {
+        readPrecomputedHeader(file, "links", hash, _dof);
+        uint32_t links = 0;
+        bool ok = fread(&links, sizeof(links), 1, file) == 1;
+        if (ok && (links == 0 || links > std::min(_dof, maxLinks)))
+        {
+            throw std::runtime_error("LinkCollisionTable: file " + filename + " has wrong number of links");
+        }
+        _bits.resize(ok ? links : 0);
+        for (size_t k = 0; k < _bits.size() && ok; ++k)
+        {
+            _bits[k].resize(tableWords(k));
+            ok = fread(_bits[k].data(), sizeof(uint64_t), _bits[k].size(), file) == _bits[k].size();
+        }
+        if (!ok)
+        {
+            throw std::runtime_error("LinkCollisionTable: file " + filename + " is too short");
+        }
+    }
+    catch (...)
+    {
+        fclose(file);
+        throw;
+    }
+    fclose(file);
+}
+
+void LinkCollisionTable::save(const std::string& filename, uint64_t hash) const
+{
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("LinkCollisionTable::save: Could not open file " + filename);
+    }
+    writePrecomputedHeader(file, "links", hash, _dof);
+    uint32_t links = _bits.size();
+    fwrite(&links, sizeof(links), 1, file);
+    for (const vector<uint64_t>& bits : _bits)
+    {
+        fwrite(bits.data(), sizeof(uint64_t), bits.size(), file);
+    }
+    fclose(file);
+}
+
+size_t LinkCollisionTable::dof() const
+{
+    return _dof;
+}
+size_t LinkCollisionTable::links() const
+{
+    return _bits.size();
+}
+size_t LinkCollisionTable::collidingLink(const JointState& state, size_t from, size_t to) const
+{
+    for (size_t k = from; k < to; ++k)
+    {
+        size_t bit = prefixIndex(state, k + 1);
+        if ((_bits[k][bit / 64] >> (bit % 64)) & 1)
+        {
+            return k;
+        }
+    }
+    return _dof;
+}
+
+std::shared_ptr<LinkCollisionTable> loadLinkCollisionTable(const ManipulatorPlanner& planner,
+    const std::string& modelFilename)
+{
+    return std::make_shared<LinkCollisionTable>(planner.dof(), precomputedFilename(modelFilename, "links"),
+        modelHash(planner.model()));
+}
@@ -0,0 +1,545 @@
+#include "multi_arm.h"
+#include "light_mujoco.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+
+vector<Action> primitiveActions(size_t dof)
+{
+    vector<Action> actions(2 * dof, Action(dof, 0));
+    for (size_t i = 0; i < dof; ++i)
+    {
+        actions[i][i] = 1;
+        actions[i + dof][i] = -1;
+    }
+    return actions;
+}
+
+// state and time of space-time search
+struct TimedKey
+{
+    uint64_t state;
+    size_t time;
+
+    bool operator==(const TimedKey& other) const
+    {
+        return state == other.state && time == other.time;
+    }
+};
+
+struct TimedKeyHash
+{
+    size_t operator()(const TimedKey& key) const
+    {
+        return hashKey(key.state * 0x9E3779B97F4A7C15ull + key.time);
+    }
+};
+
+struct OpenEntry
+{
+    CostType f;
+    CostType g;
+    size_t id;
+
+    bool operator>(const OpenEntry& other) const
+    {
+        return f > other.f || (f == other.f && g < other.g);
+    }
+};
+
+} // namespace
+
+ReservationTable::ReservationTable(double extent, double cellSize)
+{
+    _extent = extent;
+    _cellSize = cellSize;
+    _side = (size_t)std::ceil(2 * extent / cellSize);
+}
+
+vector<uint32_t> ReservationTable::cells(const mjModel* model, const mjData* data, const vector<int>& geoms) const
+{
+    vector<uint32_t> result;
+    for (int g : geoms)
+    {
+        const mjtNum* pos = data->geom_xpos + 3 * g;
+        const mjtNum* mat = data->geom_xmat + 9 * g;
+        double half = model->geom_size[3 * g + 1];
+        double radius = model->geom_size[3 * g] + _cellSize * M_SQRT1_2;
+        double x0 = pos[0] - mat[2] * half;
+        double y0 = pos[1] - mat[5] * half;
+        double dx = 2 * mat[2] * half;
+        double dy = 2 * mat[5] * half;
+        double length2 = dx * dx + dy * dy;
+
+        auto cell = [this](double value)
+        {
+            return (long)std::floor((value + _extent) / _cellSize);
+        };
+        long minX = std::max(0L, cell(std::min(x0, x0 + dx) - radius));
+        long maxX = std::min((long)_side - 1, cell(std::max(x0, x0 + dx) + radius));
+        long minY = std::max(0L, cell(std::min(y0, y0 + dy) - radius));
+        long maxY = std::min((long)_side - 1, cell(std::max(y0, y0 + dy) + radius));
+        for (long i = minX; i <= maxX; ++i)
+        {
+            for (long j = minY; j <= maxY; ++j)
+            {
+                // distance from centre of cell to segment of link axis
+                double px = -_extent + (i + 0.5) * _cellSize - x0;
+                double py = -_extent + (j + 0.5) * _cellSize - y0;
+                double t = length2 > 0 ? std::min(std::max((px * dx + py * dy) / length2, 0.0), 1.0) : 0;
+                double ex = px - t * dx;
+                double ey = py - t * dy;
+                if (ex * ex + ey * ey <= radius * radius)
+                {
+                    result.push_back(i * _side + j);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+void ReservationTable::reserve(size_t time, const vector<uint32_t>& cells)
+{
+    if (_steps.size() <= time)
+    {
+        _steps.resize(time + 1, Bitset((_side * _side + 63) / 64, 0));
+    }
+    add(_steps[time], cells);
+}
+
+void ReservationTable::reserveFrom(size_t time, const vector<uint32_t>& cells)
+{
+    Bitset bitset((_side * _side + 63) / 64, 0);
+    add(bitset, cells);
+    _final.emplace_back(time, bitset);
+}
+
+bool ReservationTable::isFree(size_t time, const vector<uint32_t>& cells) const
+{
+    if (time < _steps.size() && intersects(_steps[time], cells))
+    {
+        return false;
+    }
+    for (const auto& reserved : _final)
+    {
+        if (reserved.first <= time && intersects(reserved.second, cells))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t ReservationTable::horizon() const
+{
+    size_t result = _steps.size();
+    for (const auto& reserved : _final)
+    {
+        result = std::max(result, reserved.first);
+    }
+    return result;
+}
+
+bool ReservationTable::intersects(const Bitset& bitset, const vector<uint32_t>& cells) const
+{
+    for (uint32_t cell : cells)
+    {
+        if (bitset[cell / 64] >> (cell % 64) & 1)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ReservationTable::add(Bitset& bitset, const vector<uint32_t>& cells) const
+{
+    for (uint32_t cell : cells)
+    {
+        bitset[cell / 64] |= 1ull << (cell % 64);
+    }
+}
+
+MultiArmPlanner::MultiArmPlanner(const vector<size_t>& dofs, mjModel* model)
+{
+    if (model == nullptr)
+    {
+        throw std::runtime_error("MultiArmPlanner::MultiArmPlanner: model is not set");
+    }
+    _dofs = dofs;
+    _model = model;
+    size_t joints = 0;
+    for (size_t dof : dofs)
+    {
+        _offsets.push_back(joints);
+        joints += dof;
+    }
+    if ((int)joints > model->nq)
+    {
+        throw std::runtime_error("MultiArmPlanner::MultiArmPlanner: model has less joints than arms");
+    }
+    _data = mj_makeData(model);
+
+    // arm of geom by its joint, -1 for obstacles
+    vector<int> owner(model->ngeom, -1);
+    _geoms.resize(dofs.size());
+    for (int g = 0; g < model->ngeom; ++g)
+    {
+        int body = model->geom_bodyid[g];
+        if (model->body_jntnum[body] == 0)
+        {
+            continue;
+        }
+        size_t joint = model->jnt_qposadr[model->body_jntadr[body]];
+        for (size_t arm = 0; arm < dofs.size(); ++arm)
+        {
+            if (joint >= _offsets[arm] && joint < _offsets[arm] + dofs[arm])
+            {
+                owner[g] = arm;
+                _geoms[arm].push_back(g);
+            }
+        }
+    }
+    _pairs.resize(dofs.size());
+    for (int pair = 0; pair < model->npair; ++pair)
+    {
+        int arm1 = owner[model->pair_geom1[pair]];
+        int arm2 = owner[model->pair_geom2[pair]];
+        // pairs of two obstacles do not belong to any arm
+        if ((arm1 >= 0 || arm2 >= 0) && (arm1 < 0 || arm2 < 0 || arm1 == arm2))
+        {
+            _pairs[std::max(arm1, arm2)].push_back(pair);
+        }
+    }
+
+    // square around origin which covers every arm at any state
+    mj_kinematics(_model, _data);
+    _extent = 0;
+    for (size_t arm = 0; arm < dofs.size(); ++arm)
+    {
+        if (_geoms[arm].empty())
+        {
+            throw std::runtime_error("MultiArmPlanner::MultiArmPlanner: arm has no links");
+        }
+        double reach = 0;
+        for (int g : _geoms[arm])
+        {
+            reach += 2 * model->geom_size[3 * g + 1];
+        }
+        int base = _geoms[arm][0];
+        const mjtNum* pos = _data->geom_xpos + 3 * base;
+        const mjtNum* mat = _data->geom_xmat + 9 * base;
+        double half = model->geom_size[3 * base + 1];
+        double x = pos[0] - mat[2] * half;
+        double y = pos[1] - mat[5] * half;
+        _extent = std::max(_extent, std::max(std::abs(x), std::abs(y)) + reach);
+    }
+    _extent += 0.5;
+}
+
+MultiArmPlanner::~MultiArmPlanner()
+{
+    mj_deleteData(_data);
+}
+
+size_t MultiArmPlanner::arms() const
+{
+    return _dofs.size();
+}
+
+bool MultiArmPlanner::checkCollision(const vector<JointState>& states) const
+{
+    for (size_t arm = 0; arm < _dofs.size(); ++arm)
+    {
+        for (size_t i = 0; i < _dofs[arm]; ++i)
+        {
+            _data->qpos[_offsets[arm] + i] = states[arm].rad(i);
+        }
+    }
+    return mj_light_collision(_model, _data);
+}
+
+void MultiArmPlanner::setArm(size_t arm, const JointState& state) const
+{
+    for (size_t i = 0; i < _dofs[arm]; ++i)
+    {
+        _data->qpos[_offsets[arm] + i] = state.rad(i);
+    }
+    mj_kinematics(_model, _data);
+}
+
+bool MultiArmPlanner::checkArmCollision(size_t arm, const JointState& state) const
+{
+    setArm(arm, state);
+    for (int pair : _pairs[arm])
+    {
+        if (mj_light_collideGeoms(_model, _data, pair, -1))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+vector<uint32_t> MultiArmPlanner::armCells(size_t arm, const JointState& state, const ReservationTable& table) const
+{
+    setArm(arm, state);
+    return table.cells(_model, _data, _geoms[arm]);
+}
+
+MultiArmSolution MultiArmPlanner::plan(const vector<JointState>& starts, const vector<JointState>& goals,
+    const astar::SearchControl& control)
+{
+    auto begin = std::chrono::steady_clock::now();
+    if (starts.size() != arms() || goals.size() != arms())
+    {
+        throw std::runtime_error("MultiArmPlanner::plan: the number of states differs from the number of arms");
+    }
+    MultiArmSolution result;
+    result.stats.pathVerdict = PATH_NOT_FOUND;
+    if (checkCollision(starts) || checkCollision(goals))
+    {
+        result.stats.pathVerdict = PATH_NOT_EXISTS; // incorrect aim
+        return result;
+    }
+
+    vector<size_t> order(arms());
+    std::iota(order.begin(), order.end(), 0);
+    for (size_t attempt = 0; attempt < arms() && !control.shouldStop(); ++attempt)
+    {
+        ReservationTable table(_extent, cellSize);
+        vector<Solution> paths(arms());
+        size_t failed = arms();
+        for (size_t arm : order)
+        {
+            if (!planArm(arm, starts[arm], goals[arm], table, control, paths[arm], result.stats))
+            {
+                failed = arm;
+                break;
+            }
+            reserve(arm, starts[arm], paths[arm], table);
+        }
+        if (failed == arms())
+        {
+            size_t length = 0;
+            for (const Solution& path : paths)
+            {
+                length = std::max(length, path.size());
+                result.stats.pathCost += path.stats.pathCost;
+            }
+            for (Solution& path : paths)
+            {
+                while (path.size() < length)
+                {
+                    path.addAction(path.zeroAction());
+                }
+            }
+            result.arms = paths;
+            result.stats.pathVerdict = PATH_FOUND;
+            break;
+        }
+        if (failed == order[0])
+        {
+            // arm can not reach goal even without other arms
+            if (!control.shouldStop())
+            {
+                result.stats.pathVerdict = PATH_NOT_EXISTS;
+            }
+            break;
+        }
+        // failed arm gets the highest priority
+        order.erase(std::find(order.begin(), order.end(), failed));
+        order.insert(order.begin(), failed);
+    }
+
+    if (result.stats.pathVerdict == PATH_NOT_FOUND && useCoupledFallback && !control.shouldStop())
+    {
+        MultiArmSolution coupled = coupledPlanning(starts, goals, control);
+        coupled.stats.expansions += result.stats.expansions;
+        coupled.stats.maxTreeSize = std::max(coupled.stats.maxTreeSize, result.stats.maxTreeSize);
+        result = coupled;
+    }
+    result.stats.runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return result;
+}
+
+bool MultiArmPlanner::planArm(size_t arm, const JointState& start, const JointState& goal,
+    const ReservationTable& table, const astar::SearchControl& control, Solution& solution, Stats& stats) const
+{
+    struct Node
+    {
+        JointState state;
+        size_t time;
+        CostType g;
+        size_t parent;
+        size_t action;
+    };
+
+    size_t dof = _dofs[arm];
+    vector<Action> actions = primitiveActions(dof);
+    Action wait(dof, 0);
+    solution = Solution(actions, wait);
+    actions.push_back(wait);
+
+    // arm may stop in goal only when no other arm passes there later
+    size_t horizon = table.horizon();
+    vector<uint32_t> goalCells = armCells(arm, goal, table);
+    if (!table.isFree(horizon, goalCells))
+    {
+        return false;
+    }
+    size_t goalTime = 0;
+    for (size_t t = horizon; t-- > 0; )
+    {
+        if (!table.isFree(t, goalCells))
+        {
+            goalTime = t + 1;
+            break;
+        }
+    }
+
+    vector<Node> nodes;
+    std::unordered_map<TimedKey, size_t, TimedKeyHash> closed;
+    std::priority_queue<OpenEntry, vector<OpenEntry>, std::greater<OpenEntry>> open;
+    nodes.push_back({start.withoutLastAction(), 0, 0, 0, 0});
+    open.push({manhattanHeuristic(start, goal), 0, 0});
+    size_t expansions = 0;
+    bool found = false;
+    size_t current = 0;
+    while (!open.empty())
+    {
+        current = open.top().id;
+        open.pop();
+        // after horizon the table does not change, so time is not needed in key
+        TimedKey key{nodes[current].state.toKey(), std::min(nodes[current].time, horizon + 1)};
+        if (!closed.emplace(key, current).second)
+        {
+            continue;
+        }
+        if (control.shouldStop(expansions))
+        {
+            break;
+        }
+        ++expansions;
+        if (nodes[current].state == goal && nodes[current].time >= goalTime)
+        {
+            found = true;
+            break;
+        }
+        size_t time = nodes[current].time;
+        // arms must not swap their places during step: cells of both poses are checked at time and time + 1,
+        // the current pose is free at time, so only time + 1 is left for it
+        if (!table.isFree(time + 1, armCells(arm, nodes[current].state, table)))
+        {
+            continue;
+        }
+        for (size_t a = 0; a < actions.size(); ++a)
+        {
+            JointState next = nodes[current].state.applied(actions[a]);
+            if (!next.isCorrect() ||
+                closed.count({next.toKey(), std::min(time + 1, horizon + 1)}) ||
+                (a != actions.size() - 1 && checkArmCollision(arm, next)))
+            {
+                continue;
+            }
+            vector<uint32_t> cells = armCells(arm, next, table);
+            if (!table.isFree(time + 1, cells) || !table.isFree(time, cells))
+            {
+                continue;
+            }
+            CostType g = nodes[current].g + 1;
+            nodes.push_back({next.withoutLastAction(), time + 1, g, current, a});
+            open.push({g + manhattanHeuristic(next, goal), g, nodes.size() - 1});
+        }
+    }
+    stats.expansions += expansions;
+    stats.maxTreeSize = std::max(stats.maxTreeSize, nodes.size());
+    if (!found)
+    {
+        return false;
+    }
+
+    vector<size_t> path;
+    for (size_t id = current; id != 0; id = nodes[id].parent)
+    {
+        path.push_back(nodes[id].action);
+    }
+    for (auto action = path.rbegin(); action != path.rend(); ++action)
+    {
+        solution.addAction(actions[*action]);
+        if (*action != actions.size() - 1)
+        {
+            solution.stats.pathCost += 1;
+        }
+    }
+    solution.stats.pathVerdict = PATH_FOUND;
+    return true;
+}
+
+void MultiArmPlanner::reserve(size_t arm, const JointState& start, const Solution& path,
+    ReservationTable& table) const
+{
+    JointState state = start;
+    table.reserve(0, armCells(arm, state, table));
+    for (size_t k = 0; k < path.size(); ++k)
+    {
+        state.apply(path.getAction(k));
+        table.reserve(k + 1, armCells(arm, state, table));
+    }
+    table.reserveFrom(path.size(), armCells(arm, state, table));
+}
+
+MultiArmSolution MultiArmPlanner::coupledPlanning(const vector<JointState>& starts,
+    const vector<JointState>& goals, const astar::SearchControl& control)
+{
+    size_t joints = _offsets.back() + _dofs.back();
+    JointState start(joints);
+    JointState goal(joints);
+    for (size_t arm = 0; arm < arms(); ++arm)
+    {
+        for (size_t i = 0; i < _dofs[arm]; ++i)
+        {
+            start[_offsets[arm] + i] = starts[arm][i];
+            goal[_offsets[arm] + i] = goals[arm][i];
+        }
+    }
+    ManipulatorPlanner planner(joints, _model, _data);
+    Solution solution = planner.planActions(start, goal, ALG_ASTAR, control);
+
+    MultiArmSolution result;
+    result.coupled = true;
+    result.stats = solution.stats;
+    if (solution.stats.pathVerdict != PATH_FOUND)
+    {
+        return result;
+    }
+    for (size_t arm = 0; arm < arms(); ++arm)
+    {
+        result.arms.emplace_back(primitiveActions(_dofs[arm]), Action(_dofs[arm], 0));
+    }
+    for (size_t k = 0; k < solution.size(); ++k)
+    {
+        const Action& action = solution.getAction(k);
+        for (size_t arm = 0; arm < arms(); ++arm)
+        {
+            Action part(_dofs[arm], 0);
+            for (size_t i = 0; i < _dofs[arm]; ++i)
+            {
+                part[i] = action[_offsets[arm] + i];
+            }
+            result.arms[arm].addAction(part);
+            result.arms[arm].stats.pathCost += part.abs();
+        }
+    }
+    return result;
+}
@@ -0,0 +1,447 @@
+#include "optimizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+
+const double g_farDistance = 1e6;
+
+double circleDistance(double dx, double dy, double radius)
+{
+    return std::hypot(dx, dy) - radius;
+}
+
+double rectangleDistance(double dx, double dy, double axisX, double axisY, double halfX, double halfY)
+{
+    double u = std::abs(dx * axisX + dy * axisY) - halfX;
+    double v = std::abs(-dx * axisY + dy * axisX) - halfY;
+    double outside = std::hypot(std::max(u, 0.0), std::max(v, 0.0));
+    double inside = std::min(std::max(u, v), 0.0);
+    return outside + inside;
+}
+
+} // namespace
+
+DistanceField::DistanceField(const mjModel* model, size_t dof, double extent, size_t resolution)
+{
+    if (model == nullptr)
+    {
+        throw std::runtime_error("DistanceField::DistanceField: model is not set");
+    }
+    _extent = extent;
+    _resolution = resolution;
+    _cell = 2 * extent / resolution;
+
+    // positions of static geoms are known only after kinematics
+    mjData* data = mj_makeData(model);
+    mj_kinematics(model, data);
+    vector<bool> added(model->ngeom, false);
+    for (int pair = 0; pair < model->npair; ++pair)
+    {
+        for (int g : {model->pair_geom1[pair], model->pair_geom2[pair]})
+        {
+            if ((g >= 1 && g <= (int)dof) || added[g] || model->geom_type[g] == mjGEOM_PLANE)
+            {
+                continue;
+            }
+            added[g] = true;
+            const mjtNum* pos = data->geom_xpos + 3 * g;
+            const mjtNum* mat = data->geom_xmat + 9 * g;
+            const mjtNum* size = model->geom_size + 3 * g;
+            Shape shape{mjGEOM_SPHERE, pos[0], pos[1], 1, 0, model->geom_rbound[g], 0};
+            switch (model->geom_type[g])
+            {
+            case mjGEOM_BOX:
+                // box is supposed to be rotated only around vertical axis
+                shape = Shape{mjGEOM_BOX, pos[0], pos[1], mat[0], mat[3], size[0], size[1]};
+                break;
+            case mjGEOM_SPHERE:
+                shape.halfX = size[0];
+                break;
+            case mjGEOM_CYLINDER:
+            case mjGEOM_CAPSULE:
+            {
+                double length = std::hypot(mat[2], mat[5]);
+                if (length < 0.5) // stands on the plane
+                {
+                    shape.halfX = size[0];
+                }
+                else // lies on the plane
+                {
+                    double cap = model->geom_type[g] == mjGEOM_CAPSULE ? size[0] : 0;
+                    shape = Shape{mjGEOM_BOX, pos[0], pos[1], mat[2] / length, mat[5] / length,
+                        size[1] + cap, size[0]};
+                }
+                break;
+            }
+            default:
+                break;
+            }
+            _shapes.push_back(shape);
+        }
+    }
+    mj_deleteData(data);
+
+    _distances.resize((_resolution + 1) * (_resolution + 1));
+    for (size_t i = 0; i <= _resolution; ++i)
+    {
+        for (size_t j = 0; j <= _resolution; ++j)
+        {
+            _distances[i * (_resolution + 1) + j] = exactDistance(-_extent + i * _cell, -_extent + j * _cell);
+        }
+    }
+}
+
+double DistanceField::distance(double x, double y) const
+{
+    double fx = std::min(std::max((x + _extent) / _cell, 0.0), _resolution - 1e-9);
+    double fy = std::min(std::max((y + _extent) / _cell, 0.0), _resolution - 1e-9);
+    size_t i = (size_t)fx;
+    size_t j = (size_t)fy;
+    double tx = fx - i;
+    double ty = fy - j;
+    const float* row = _distances.data() + i * (_resolution + 1) + j;
+    const float* next = row + _resolution + 1;
+    return (1 - tx) * ((1 - ty) * row[0] + ty * row[1]) + tx * ((1 - ty) * next[0] + ty * next[1]);
+}
+
+double DistanceField::exactDistance(double x, double y) const
+{
+    double result = g_farDistance;
+    for (const Shape& shape : _shapes)
+    {
+        double dx = x - shape.x;
+        double dy = y - shape.y;
+        if (shape.type == mjGEOM_BOX)
+        {
+            result = std::min(result, rectangleDistance(dx, dy, shape.axisX, shape.axisY, shape.halfX, shape.halfY));
+        }
+        else
+        {
+            result = std::min(result, circleDistance(dx, dy, shape.halfX));
+        }
+    }
+    return result;
+}
+
+TrajectoryOptimizer::TrajectoryOptimizer(ManipulatorPlanner& planner)
+    : _planner(&planner),
+      _data(nullptr),
+      _field(planner.model(), planner.dof(), planner.modelLength() * 1.1 + 0.2)
+{
+    _data = mj_makeData(planner.model());
+}
+
+TrajectoryOptimizer::~TrajectoryOptimizer()
+{
+    mj_deleteData(_data);
+}
+
+Solution TrajectoryOptimizer::plan(const JointState& startPos, const JointState& goalPos,
+    const astar::SearchControl& control)
+{
+    auto begin = std::chrono::steady_clock::now();
+    size_t dof = _planner->dof();
+
+    Solution solution(_planner->primitiveActions(), Action(dof, 0));
+    Trajectory trajectory = lineSeed(startPos, goalPos, false);
+    bool found = optimize(trajectory, startPos, goalPos, control, solution);
+    if (!found && startPos[0] != goalPos[0] && !control.shouldStop())
+    {
+        // obstacle may be between start and goal, but not on the other side of cyclic joint
+        trajectory = lineSeed(startPos, goalPos, true);
+        found = optimize(trajectory, startPos, goalPos, control, solution);
+    }
+    Stats stats;
+    if (!found && useAstarSeed && !control.shouldStop())
+    {
+        Solution path = _planner->planActions(startPos, goalPos, ALG_ASTAR, control, astarWeight);
+        stats.expansions = path.stats.expansions;
+        stats.maxTreeSize = path.stats.maxTreeSize;
+        stats.pathVerdict = path.stats.pathVerdict;
+        if (path.stats.pathVerdict == PATH_FOUND)
+        {
+            trajectory = pathSeed(startPos, path);
+            solution = Solution(_planner->primitiveActions(), Action(dof, 0));
+            found = optimize(trajectory, startPos, goalPos, control, solution);
+            if (!found)
+            {
+                // path of A* is valid, though it is not smooth
+                solution = path;
+                found = true;
+            }
+        }
+    }
+    stats.pathCost = solution.stats.pathCost;
+    solution.stats = stats;
+    if (found)
+    {
+        solution.stats.pathVerdict = PATH_FOUND;
+        solution.stats.pathPotentialCost = manhattanHeuristic(startPos, goalPos);
+    }
+    solution.stats.runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return solution;
+}
+
+TrajectoryOptimizer::Trajectory TrajectoryOptimizer::lineSeed(const JointState& startPos,
+    const JointState& goalPos, bool longWay) const
+{
+    size_t dof = startPos.dof();
+    Action diff = difference(startPos, goalPos);
+    if (longWay)
+    {
+        diff[0] += diff[0] > 0 ? -2 * g_units : 2 * g_units;
+    }
+    int distance = 0;
+    for (size_t i = 0; i < dof; ++i)
+    {
+        distance = std::max(distance, std::abs(diff[i]));
+    }
+    size_t segments = std::max<size_t>(1, (size_t)std::ceil(distance / waypointDistance));
+    Trajectory trajectory(segments + 1, vector<double>(dof));
+    for (size_t k = 0; k <= segments; ++k)
+    {
+        for (size_t i = 0; i < dof; ++i)
+        {
+            trajectory[k][i] = startPos[i] + (double)diff[i] * k / segments;
+        }
+    }
+    return trajectory;
+}
+
+TrajectoryOptimizer::Trajectory TrajectoryOptimizer::pathSeed(const JointState& startPos,
+    const Solution& path) const
+{
+    size_t dof = startPos.dof();
+    size_t period = std::max<size_t>(1, (size_t)std::lround(waypointDistance));
+    vector<double> state(dof);
+    for (size_t i = 0; i < dof; ++i)
+    {
+        state[i] = startPos[i];
+    }
+    Trajectory trajectory = {state};
+    for (size_t k = 0; k < path.size(); ++k)
+    {
+        const Action& action = path.getAction(k);
+        for (size_t i = 0; i < dof; ++i)
+        {
+            state[i] += action[i];
+        }
+        if ((k + 1) % period == 0 || k + 1 == path.size())
+        {
+            trajectory.push_back(state);
+        }
+    }
+    if (trajectory.size() == 1)
+    {
+        trajectory.push_back(state);
+    }
+    return trajectory;
+}
+
+void TrajectoryOptimizer::resample(Trajectory& trajectory) const
+{
+    size_t dof = trajectory[0].size();
+    vector<double> length(trajectory.size(), 0); // from start by the maximum move of joint
+    for (size_t k = 1; k < trajectory.size(); ++k)
+    {
+        double segment = 0;
+        for (size_t i = 0; i < dof; ++i)
+        {
+            segment = std::max(segment, std::abs(trajectory[k][i] - trajectory[k - 1][i]));
+        }
+        length[k] = length[k - 1] + segment;
+    }
+    size_t segments = std::max<size_t>(1, (size_t)std::ceil(length.back() / waypointDistance));
+    Trajectory result(segments + 1, vector<double>(dof));
+    size_t k = 1;
+    for (size_t j = 0; j <= segments; ++j)
+    {
+        double position = length.back() * j / segments;
+        while (k + 1 < trajectory.size() && length[k] < position)
+        {
+            ++k;
+        }
+        double t = length[k] > length[k - 1] ? (position - length[k - 1]) / (length[k] - length[k - 1]) : 1;
+        t = std::min(std::max(t, 0.0), 1.0);
+        for (size_t i = 0; i < dof; ++i)
+        {
+            result[j][i] = trajectory[k - 1][i] + (trajectory[k][i] - trajectory[k - 1][i]) * t;
+        }
+    }
+    // endpoints must be kept exactly
+    result.front() = trajectory.front();
+    result.back() = trajectory.back();
+    trajectory.swap(result);
+}
+
+bool TrajectoryOptimizer::optimize(Trajectory& trajectory, const JointState& startPos,
+    const JointState& goalPos, const astar::SearchControl& control, Solution& solution)
+{
+    size_t dof = startPos.dof();
+    const double delta = 0.5; // step of finite differences in planner units
+    const double maxStep = 1; // the maximum move of waypoint in one iteration in planner units
+
+    double lastCost = g_farDistance; // mean obstacle cost of waypoint on the last validation
+    vector<vector<double>> gradient;
+    vector<double> upper;
+    vector<double> column;
+    for (size_t iteration = 0; iteration <= maxIterations && !control.shouldStop(); ++iteration)
+    {
+        if (iteration > 0 && iteration % validationPeriod == 0)
+        {
+            // gradient steps move waypoints along trajectory too, gaps between them
+            // are not seen by obstacle cost
+            resample(trajectory);
+        }
+        size_t n = trajectory.size() - 2; // the number of free waypoints
+        gradient.resize(n, vector<double>(dof));
+        upper.resize(n);
+        column.resize(n);
+        double cost = 0;
+        for (size_t k = 0; k < n; ++k)
+        {
+            vector<double>& waypoint = trajectory[k + 1];
+            double base = obstacleCost(waypoint);
+            cost += base;
+            for (size_t i = 0; i < dof; ++i)
+            {
+                // smoothness: derivative of sum of squared differences of neighbours
+                gradient[k][i] = 2 * waypoint[i] - trajectory[k][i] - trajectory[k + 2][i];
+                if (base > 0)
+                {
+                    waypoint[i] += delta;
+                    gradient[k][i] += obstacleWeight * (obstacleCost(waypoint) - base) / delta;
+                    waypoint[i] -= delta;
+                }
+            }
+        }
+        if (cost == 0 || iteration % validationPeriod == 0 || iteration == maxIterations)
+        {
+            Solution candidate(_planner->primitiveActions(), Action(dof, 0));
+            if (toSolution(trajectory, startPos, goalPos, candidate))
+            {
+                solution = candidate;
+                return true;
+            }
+            // gradient can not help anymore
+            double meanCost = cost / std::max<size_t>(n, 1);
+            if (cost == 0 || meanCost > stallRatio * lastCost)
+            {
+                return false;
+            }
+            lastCost = meanCost;
+        }
+        if (iteration == maxIterations || n == 0)
+        {
+            break;
+        }
+
+        // covariant step: gradient is multiplied by inverse of smoothness metric,
+        // which is tridiagonal matrix with 2 on diagonal and -1 near it
+        double largest = 0;
+        for (size_t i = 0; i < dof; ++i)
+        {
+            // Thomas algorithm, upper - modified coefficients over diagonal
+            for (size_t k = 0; k < n; ++k)
+            {
+                double pivot = k == 0 ? 2 : 2 + upper[k - 1];
+                upper[k] = -1 / pivot;
+                column[k] = (gradient[k][i] + (k == 0 ? 0 : column[k - 1])) / pivot;
+            }
+            for (size_t k = n; k-- > 0; )
+            {
+                if (k + 1 < n)
+                {
+                    column[k] -= upper[k] * column[k + 1];
+                }
+                gradient[k][i] = column[k];
+                largest = std::max(largest, std::abs(learningRate * column[k]));
+            }
+        }
+        double scale = largest > maxStep ? maxStep / largest : 1;
+        for (size_t k = 0; k < n; ++k)
+        {
+            for (size_t i = 0; i < dof; ++i)
+            {
+                double& value = trajectory[k + 1][i];
+                value -= scale * learningRate * gradient[k][i];
+                if (i > 0)
+                {
+                    value = std::min(std::max(value, (double)-g_units), g_units - 1.0);
+                }
+            }
+        }
+    }
+    return false;
+}
+
+double TrajectoryOptimizer::obstacleCost(const vector<double>& waypoint) const
+{
+    const mjModel* model = _planner->model();
+    size_t dof = waypoint.size();
+    for (size_t i = 0; i < dof; ++i)
+    {
+        _data->qpos[i] = g_eps * waypoint[i];
+    }
+    mj_kinematics(model, _data);
+
+    double cost = 0;
+    for (size_t g = 1; g <= dof; ++g)
+    {
+        const mjtNum* pos = _data->geom_xpos + 3 * g;
+        const mjtNum* mat = _data->geom_xmat + 9 * g;
+        double radius = model->geom_size[3 * g];
+        double half = model->geom_size[3 * g + 1];
+        for (size_t p = 0; p < linkPoints; ++p)
+        {
+            double s = linkPoints == 1 ? 0 : -1 + 2.0 * p / (linkPoints - 1);
+            double distance = _field.distance(pos[0] + mat[2] * half * s, pos[1] + mat[5] * half * s) - radius;
+            if (distance < 0)
+            {
+                cost += margin / 2 - distance;
+            }
+            else if (distance < margin)
+            {
+                cost += (distance - margin) * (distance - margin) / (2 * margin);
+            }
+        }
+    }
+    return cost;
+}
+
+bool TrajectoryOptimizer::toSolution(const Trajectory& trajectory, const JointState& startPos,
+    const JointState& goalPos, Solution& solution) const
+{
+    size_t dof = startPos.dof();
+    JointState current = startPos;
+    vector<long> unwrapped(dof);
+    for (size_t i = 0; i < dof; ++i)
+    {
+        unwrapped[i] = startPos[i];
+    }
+    for (size_t k = 1; k < trajectory.size(); ++k)
+    {
+        Action move(dof, 0);
+        for (size_t i = 0; i < dof; ++i)
+        {
+            long rounded = std::lround(trajectory[k][i]);
+            move[i] = rounded - unwrapped[i];
+            unwrapped[i] = rounded;
+        }
+        for (const Action& step : lineActions(current, current.applied(move)))
+        {
+            if (!_planner->isCorrect(current, step) || _planner->checkCollisionAction(current, step, 1))
+            {
+                return false;
+            }
+            _planner->addStep(solution, current, step);
+            current.apply(step);
+        }
+    }
+    return current == goalPos;
+}
@@ -1,23 +1,113 @@
 #include "planner.h"
+#include "hpa.h"
+#include "ch.h"
+#include "cpd.h"
+#include "components.h"
+#include "roadmap.h"
+#include "rrt.h"
+#include "optimizer.h"
+#include "theta.h"
+#include "rsr.h"
+#include "link_table.h"
 #include "utils.h"
 #include "light_mujoco.h"
+#include "joint_kernels.h"
 
+#include <algorithm>
+#include <stdexcept>
+#include <string>
 #include <time.h>
 
 #include <stdio.h>
 
+bool needsGoalState(int alg)
+{
+    switch (alg)
+    {
+    case ALG_LINEAR:
+    case ALG_HPA:
+    case ALG_CH:
+    case ALG_CPD:
+    case ALG_ROADMAP:
+    case ALG_RRT_CONNECT:
+    case ALG_OPTIMIZE:
+    case ALG_THETA:
+    case ALG_RSR:
+        return true;
+    default:
+        return false;
+    }
+}
+
 ManipulatorPlanner::ManipulatorPlanner(size_t dof, mjModel* model, mjData* data)
 {
     _dof = dof;
     _model = model;
     _data = data;
+    initJointLimits();
+    initPrimitiveActions();
+    initModelLength();
+    initKinematics();
+    initDofKernels();
+}
+ManipulatorPlanner::ManipulatorPlanner(const ManipulatorPlanner& other)
+{
+    _dof = other._dof;
+    _model = other._model;
+    _data = nullptr;
+    if (_model != nullptr)
+    {
+        _data = mj_makeData(_model);
+        _ownsData = true;
+    }
+    _externalConfig = other._externalConfig;
+    _hierarchicalGraph = other._hierarchicalGraph;
+    _contractionHierarchy = other._contractionHierarchy;
+    _pathDatabase = other._pathDatabase;
+    _componentMap = other._componentMap;
+    _roadmap = other._roadmap;
+    _symmetryReduction = other._symmetryReduction;
+    initJointLimits();
     initPrimitiveActions();
+    initModelLength();
+    initKinematics();
+    setLinkCollisionTable(other._linkTable);
+    initDofKernels();
+}
+ManipulatorPlanner::~ManipulatorPlanner()
+{
+    if (_ownsData)
+    {
+        mj_deleteData(_data);
+    }
 }
 
 size_t ManipulatorPlanner::dof() const
 {
     return _dof;
 }
+const vector<Action>& ManipulatorPlanner::primitiveActions() const
+{
+    return _primitiveActions;
+}
+const mjModel* ManipulatorPlanner::model() const
+{
+    return _model;
+}
+
+const JointLimits& ManipulatorPlanner::limits() const
+{
+    return _limits;
+}
+bool ManipulatorPlanner::isCorrect(const JointState& state) const
+{
+    return state.isCorrect(_limits);
+}
+bool ManipulatorPlanner::isCorrect(const JointState& state, const Action& action) const
+{
+    JointValue result[g_maxDof];
+    return jointKernels().addBatch(state.data(), action.data(), 0, 1, result, 0, _limits) & 1;
+}
 
 bool ManipulatorPlanner::checkCollision(const JointState& position) const
 {
@@ -26,41 +116,81 @@ bool ManipulatorPlanner::checkCollision(const JointState& position) const
         return false;
     }
 
-    for (size_t i = 0; i < _dof; ++i)
+    _hasContext = false;
+    if (_chain.supported())
     {
-        _data->qpos[i] = position.rad(i);
+        int angles[g_maxDof];
+        for (size_t i = 0; i < _dof; ++i)
+        {
+            angles[i] = position[i] * g_unitSize;
+        }
+        if (_tabledLinks > 0 && _linkTable->collidingLink(position, 0, _tabledLinks) < _dof)
+        {
+            return true;
+        }
+        _chain.kinematics(_data, angles);
+        return _chain.collidingLink(_model, _data, _tabledLinks, _dof) < _dof;
     }
+    (this->*_setPosition)(position);
     return mj_light_collision(_model, _data);
 }
 
-bool ManipulatorPlanner::checkCollisionAction(const JointState& start, const Action& action) const
+bool ManipulatorPlanner::checkCollisionAction(const JointState& start, const Action& action, size_t jump) const
 {
     startProfiling();
     if (_model == nullptr || _data == nullptr) // if we have not data for check
     {
         return false;
     }
+    bool result = (this->*_checkCollisionAction)(start, action, jump);
+    stopProfiling();
+    return result;
+}
 
-    for (size_t i = 0; i < _dof; ++i)
+void ManipulatorPlanner::addStep(Solution& solution, const JointState& state, const Action& step) const
+{
+    solution.stats.pathCost += step.abs();
+    vector<size_t> joints;
+    for (size_t i = 0; i < step.dof(); ++i)
     {
-        _data->qpos[i] = start.rad(i);
+        if (step[i] != 0)
+        {
+            joints.push_back(i);
+        }
     }
-
-    int jump = 8;
-    for (size_t t = jump; t <= g_unitSize; t += jump)
+    if (joints.size() == 1)
     {
-        for (size_t i = 0; i < _dof; ++i)
+        solution.addAction(step);
+        return;
+    }
+    // greedy order of joints, where every intermediate state is free
+    vector<Action> primitives;
+    JointState current = state;
+    while (!joints.empty())
+    {
+        bool moved = false;
+        for (size_t k = 0; k < joints.size() && !moved; ++k)
         {
-            _data->qpos[i] = start.rad(i) + g_worldEps * action[i] * t; // temporary we use global constant here for speed
+            Action primitive(step.dof(), 0);
+            primitive[joints[k]] = step[joints[k]];
+            if (isCorrect(current, primitive) && !checkCollisionAction(current, primitive))
+            {
+                current.apply(primitive);
+                primitives.push_back(primitive);
+                joints.erase(joints.begin() + k);
+                moved = true;
+            }
         }
-        if (mj_light_collision(_model, _data))
+        if (!moved)
         {
-            stopProfiling();
-            return true;
+            solution.addAction(step);
+            return;
         }
     }
-    stopProfiling();
-    return false;
+    for (const Action& primitive : primitives)
+    {
+        solution.addAction(primitive);
+    }
 }
 
 vector<string> ManipulatorPlanner::configurationSpace() const
@@ -103,6 +233,17 @@ vector<string> ManipulatorPlanner::manipulatorPath(Solution s, const JointState&
 }
 
 Solution ManipulatorPlanner::planActions(const JointState& startPos, const JointState& goalPos, int alg, double timeLimit, double w)
+{
+    return planActions(startPos, goalPos, alg, astar::SearchControl(timeLimit), w);
+}
+
+Solution ManipulatorPlanner::planActions(const JointState& startPos, double goalX, double goalY, int alg, double timeLimit, double w)
+{
+    return planActions(startPos, goalX, goalY, alg, astar::SearchControl(timeLimit), w);
+}
+
+Solution ManipulatorPlanner::planActions(const JointState& startPos, const JointState& goalPos, int alg,
+    const astar::SearchControl& control, double w)
 {
     clearAllProfiling(); // reset profiling
 
@@ -112,65 +253,225 @@ Solution ManipulatorPlanner::planActions(const JointState& startPos, const Joint
         solution.stats.pathVerdict = PATH_NOT_EXISTS; // incorrect aim
         return  solution;
     }
+    if (!isCorrect(startPos) || !isCorrect(goalPos) || !isReachableByStep(startPos, goalPos))
+    {
+        Solution solution(_primitiveActions, _zeroAction);
+        solution.stats.pathVerdict = PATH_NOT_EXISTS; // out of limits or off grid of steps
+        return solution;
+    }
+    if (_componentMap != nullptr && !_componentMap->connected(startPos, goalPos))
+    {
+        Solution solution(_primitiveActions, _zeroAction);
+        solution.stats.pathVerdict = PATH_NOT_EXISTS; // different components of free space
+        return solution;
+    }
     switch (alg)
     {
     case ALG_LINEAR:
         return linearPlanning(startPos, goalPos);
     case ALG_ASTAR:
-        return astarPlanning(startPos, goalPos, w, timeLimit);
+    case ALG_ASTAR_EXTERNAL:
+        return astarPlanning(startPos, goalPos, w, control, alg);
+    case ALG_HPA:
+        if (_hierarchicalGraph == nullptr)
+        {
+            throw std::runtime_error("ManipulatorPlanner::planActions: hierarchical graph is not set for ALG_HPA");
+        }
+        return _hierarchicalGraph->plan(startPos, goalPos, _primitiveActions, _zeroAction);
+    case ALG_CH:
+        if (_contractionHierarchy == nullptr)
+        {
+            throw std::runtime_error("ManipulatorPlanner::planActions: contraction hierarchy is not set for ALG_CH");
+        }
+        return _contractionHierarchy->plan(startPos, goalPos, _primitiveActions, _zeroAction);
+    case ALG_CPD:
+        if (_pathDatabase == nullptr)
+        {
+            throw std::runtime_error("ManipulatorPlanner::planActions: path database is not set for ALG_CPD");
+        }
+        return _pathDatabase->plan(startPos, goalPos, _primitiveActions, _zeroAction);
+    case ALG_ROADMAP:
+        if (_roadmap == nullptr)
+        {
+            throw std::runtime_error("ManipulatorPlanner::planActions: roadmap is not set for ALG_ROADMAP");
+        }
+        return _roadmap->plan(*this, startPos, goalPos, control);
+    case ALG_RRT_CONNECT:
+        return RrtConnect(*this).plan(startPos, goalPos, control);
+    case ALG_OPTIMIZE:
+        return TrajectoryOptimizer(*this).plan(startPos, goalPos, control);
+    case ALG_THETA:
+        return ThetaStar(*this).plan(startPos, goalPos, control, w);
+    case ALG_RSR:
+        if (_symmetryReduction == nullptr)
+        {
+            throw std::runtime_error("ManipulatorPlanner::planActions: symmetry reduction is not set for ALG_RSR");
+        }
+        return _symmetryReduction->plan(startPos, goalPos, _primitiveActions, _zeroAction);
     default:
         return Solution(_primitiveActions, _zeroAction);
     }
 }
 
-Solution ManipulatorPlanner::planActions(const JointState& startPos, double goalX, double goalY, int alg, double timeLimit, double w)
+Solution ManipulatorPlanner::planActions(const JointState& startPos, double goalX, double goalY, int alg,
+    const astar::SearchControl& control, double w)
 {
     clearAllProfiling(); // reset profiling
 
-    if (checkCollision(startPos))
+    if (checkCollision(startPos) || !isCorrect(startPos))
     {
         Solution solution(_primitiveActions, _zeroAction);
         solution.stats.pathVerdict = PATH_NOT_EXISTS; // incorrect aim
         return  solution;
     }
+    if (_componentMap != nullptr && !_componentMap->mayReach(startPos, goalX, goalY, g_goalRadius))
+    {
+        Solution solution(_primitiveActions, _zeroAction);
+        solution.stats.pathVerdict = PATH_NOT_EXISTS; // goal is out of reach in component of start
+        return solution;
+    }
     switch (alg)
     {
     case ALG_ASTAR:
-        return astarPlanning(startPos, goalX, goalY, w, timeLimit);
+    case ALG_ASTAR_EXTERNAL:
+        return astarPlanning(startPos, goalX, goalY, w, control, alg);
     default:
         return Solution(_primitiveActions, _zeroAction);
     }
 }
 
-double ManipulatorPlanner::modelLength() const
+std::future<Solution> ManipulatorPlanner::planAsync(const JointState& startPos, const JointState& goalPos, int alg,
+    const astar::SearchControl& control, double w)
 {
-    static double len = 0;
-    if (len == 0)
+    return std::async(std::launch::async, [this, startPos, goalPos, alg, control, w]()
     {
-        for (size_t i = 1; i <= _dof; ++i)
-        {
-            len += _model->geom_size[i * 3 + 1] * 2;
-        }
-    }
-    return len;
+        return planActions(startPos, goalPos, alg, control, w);
+    });
+}
+std::future<Solution> ManipulatorPlanner::planAsync(const JointState& startPos, double goalX, double goalY, int alg,
+    const astar::SearchControl& control, double w)
+{
+    return std::async(std::launch::async, [this, startPos, goalX, goalY, alg, control, w]()
+    {
+        return planActions(startPos, goalX, goalY, alg, control, w);
+    });
+}
+
+double ManipulatorPlanner::modelLength() const
+{
+    return _modelLength;
 }
 double ManipulatorPlanner::maxActionLength() const
 {
-    static double maxAction = sin(g_eps / 2) * modelLength() * 2;
-    return maxAction;
+    return _maxActionLength;
 }
 std::pair<double, double> ManipulatorPlanner::sitePosition(const JointState& state) const
 {
     startProfiling();
-    for (size_t i = 0; i < _dof; ++i)
+    // both branches overwrite poses of collision context
+    _hasContext = false;
+    if (_chain.sitesSupported())
     {
-        _data->qpos[i] = state.rad(i);
+        int angles[g_maxDof];
+        for (size_t i = 0; i < _dof; ++i)
+        {
+            angles[i] = state[i] * g_unitSize;
+        }
+        _chain.kinematics(_data, angles);
+    }
+    else
+    {
+        (this->*_setPosition)(state);
+        mj_forward(_model, _data);
     }
-    mj_forward(_model, _data);
     stopProfiling();
     return {_data->site_xpos[0], _data->site_xpos[1]};
 }
 
+void ManipulatorPlanner::setExternalMemoryConfig(const astar::ExternalMemoryConfig& config)
+{
+    _externalConfig = config;
+}
+void ManipulatorPlanner::setHierarchicalGraph(std::shared_ptr<const HierarchicalGraph> graph)
+{
+    _hierarchicalGraph = graph;
+}
+void ManipulatorPlanner::setContractionHierarchy(std::shared_ptr<const ContractionHierarchy> hierarchy)
+{
+    _contractionHierarchy = hierarchy;
+}
+void ManipulatorPlanner::setPathDatabase(std::shared_ptr<const CompressedPathDatabase> database)
+{
+    _pathDatabase = database;
+}
+void ManipulatorPlanner::setComponentMap(std::shared_ptr<const ComponentMap> components)
+{
+    _componentMap = components;
+}
+void ManipulatorPlanner::setRoadmap(std::shared_ptr<const Roadmap> roadmap)
+{
+    _roadmap = roadmap;
+}
+void ManipulatorPlanner::setSymmetryReduction(std::shared_ptr<const SymmetryReduction> reduction)
+{
+    _symmetryReduction = reduction;
+}
+void ManipulatorPlanner::setLinkCollisionTable(std::shared_ptr<const LinkCollisionTable> table)
+{
+    if (table != nullptr && table->dof() != _dof)
+    {
+        throw std::runtime_error("ManipulatorPlanner::setLinkCollisionTable: table was built for another dof");
+    }
+    _linkTable = table;
+    _tabledLinks = table != nullptr && _chain.supported() ? table->links() : 0;
+}
+
+void ManipulatorPlanner::initJointLimits()
+{
+    _limits = JointLimits();
+    if (_model == nullptr)
+    {
+        return;
+    }
+    for (size_t i = 0; i < _dof && i < (size_t)_model->njnt; ++i)
+    {
+        if (!_model->jnt_limited[i])
+        {
+            continue;
+        }
+        int low = std::ceil(_model->jnt_range[2 * i] / g_eps - 1e-9);
+        int high = std::floor(_model->jnt_range[2 * i + 1] / g_eps + 1e-9);
+        _limits.low[i] = std::max(low, -g_units);
+        _limits.high[i] = std::min(high, g_units - 1);
+        _limits.period[i] = 0;
+        if (_limits.low[i] > _limits.high[i])
+        {
+            throw std::runtime_error("ManipulatorPlanner: range of joint " + std::to_string(i) + " is empty");
+        }
+    }
+    int steps = mj_name2id(_model, mjOBJ_NUMERIC, "joint_steps");
+    if (steps < 0)
+    {
+        return;
+    }
+    for (size_t i = 0; i < _dof && i < (size_t)_model->numeric_size[steps]; ++i)
+    {
+        int step = _model->numeric_data[_model->numeric_adr[steps] + i];
+        // cyclic joint must come back to the same value after full turn
+        if (step <= 0 || step > g_units || (2 * g_units) % step != 0)
+        {
+            throw std::runtime_error("ManipulatorPlanner: step of joint must divide 2 * g_units");
+        }
+        // values of joint are multiples of step, -g_units is one of them
+        if ((_limits.low[i] + g_units + step - 1) / step * step - g_units > _limits.high[i])
+        {
+            throw std::runtime_error("ManipulatorPlanner: range of joint " + std::to_string(i) +
+                " has no multiple of its step");
+        }
+        _limits.step[i] = step;
+    }
+}
+
 void ManipulatorPlanner::initPrimitiveActions()
 {
     _zeroAction = Action(_dof, 0);
@@ -179,9 +480,188 @@ void ManipulatorPlanner::initPrimitiveActions()
 
     for (int i = 0; i < _dof; ++i)
     {
-        _primitiveActions[i][i] = 1;
-        _primitiveActions[i + _dof][i] = -1;
+        _primitiveActions[i][i] = _limits.step[i];
+        _primitiveActions[i + _dof][i] = -_limits.step[i];
+    }
+}
+
+bool ManipulatorPlanner::isReachableByStep(const JointState& startPos, const JointState& goalPos) const
+{
+    for (size_t i = 0; i < _dof; ++i)
+    {
+        if ((goalPos[i] - startPos[i]) % _limits.step[i] != 0)
+        {
+            return false;
+        }
     }
+    return true;
+}
+
+void ManipulatorPlanner::initDofKernels()
+{
+    switch (_dof)
+    {
+    case 1:
+        _setPosition = &ManipulatorPlanner::setPosition<1>;
+        _checkCollisionAction = &ManipulatorPlanner::checkCollisionActionDof<1>;
+        break;
+    case 2:
+        _setPosition = &ManipulatorPlanner::setPosition<2>;
+        _checkCollisionAction = &ManipulatorPlanner::checkCollisionActionDof<2>;
+        break;
+    case 3:
+        _setPosition = &ManipulatorPlanner::setPosition<3>;
+        _checkCollisionAction = &ManipulatorPlanner::checkCollisionActionDof<3>;
+        break;
+    case 4:
+        _setPosition = &ManipulatorPlanner::setPosition<4>;
+        _checkCollisionAction = &ManipulatorPlanner::checkCollisionActionDof<4>;
+        break;
+    case 5:
+        _setPosition = &ManipulatorPlanner::setPosition<5>;
+        _checkCollisionAction = &ManipulatorPlanner::checkCollisionActionDof<5>;
+        break;
+    case 6:
+        _setPosition = &ManipulatorPlanner::setPosition<6>;
+        _checkCollisionAction = &ManipulatorPlanner::checkCollisionActionDof<6>;
+        break;
+    case 7:
+        _setPosition = &ManipulatorPlanner::setPosition<7>;
+        _checkCollisionAction = &ManipulatorPlanner::checkCollisionActionDof<7>;
+        break;
+    case 8:
+        _setPosition = &ManipulatorPlanner::setPosition<8>;
+        _checkCollisionAction = &ManipulatorPlanner::checkCollisionActionDof<8>;
+        break;
+    default:
+        _setPosition = &ManipulatorPlanner::setPosition<0>;
+        _checkCollisionAction = &ManipulatorPlanner::checkCollisionActionDof<0>;
+    }
+}
+
+template <size_t Dof>
+void ManipulatorPlanner::setPosition(const JointState& state) const
+{
+    const size_t dof = Dof == 0 ? _dof : Dof;
+    for (size_t i = 0; i < dof; ++i)
+    {
+        _data->qpos[i] = state.rad(i);
+    }
+}
+
+template <size_t Dof>
+bool ManipulatorPlanner::checkCollisionActionDof(const JointState& start, const Action& action, size_t jump) const
+{
+    const size_t dof = Dof == 0 ? _dof : Dof;
+    if (_chain.supported())
+    {
+        // angles of sub-steps are exact multiples of g_worldEps
+        int base[g_maxDof];
+        int angles[g_maxDof];
+        for (size_t i = 0; i < dof; ++i)
+        {
+            base[i] = start[i] * g_unitSize;
+        }
+        // successors of one state are checked one by one, so poses and collisions of start are kept
+        if (!_hasContext || !(_context == start))
+        {
+            _chain.kinematics(_data, base);
+            _context = start;
+            _hasContext = true;
+            _contextChecked = 0;
+            _contextCollision = dof;
+            _contextMoved = dof;
+        }
+        size_t moved = 0;
+        while (moved < dof && action[moved] == 0)
+        {
+            ++moved;
+        }
+        // links before the first moved joint do not move, so their collisions are checked at start once
+        if (_contextChecked < moved && _contextCollision == dof)
+        {
+            // start is lattice state, so the first links are looked up in table
+            size_t tabled = std::min(moved, _tabledLinks);
+            if (_contextChecked < tabled)
+            {
+                _contextCollision = _linkTable->collidingLink(start, _contextChecked, tabled);
+            }
+            if (_contextCollision == dof && std::max(_contextChecked, tabled) < moved)
+            {
+                if (_contextMoved < moved)
+                {
+                    _chain.kinematics(_data, base, _contextMoved);
+                    _contextMoved = dof;
+                }
+                _contextCollision = _chain.collidingLink(_model, _data, std::max(_contextChecked, tabled), moved);
+            }
+            _contextChecked = moved;
+        }
+        if (_contextCollision < moved)
+        {
+            return true;
+        }
+        // links which were moved by the previous action are put back by the first kinematics
+        _contextMoved = std::min(moved, _contextMoved);
+        for (int t = jump; t <= g_unitSize; t += jump)
+        {
+            // the end of action is lattice state, so moved links which are in table are looked up
+            size_t tabled = t == g_unitSize ? std::max(moved, _tabledLinks) : moved;
+            if (tabled > moved && _linkTable->collidingLink(start.applied(action), moved, tabled) < dof)
+            {
+                return true;
+            }
+            for (size_t i = 0; i < dof; ++i)
+            {
+                angles[i] = base[i] + action[i] * t;
+            }
+            _chain.kinematics(_data, angles, _contextMoved);
+            _contextMoved = moved;
+            if (_chain.collidingLink(_model, _data, tabled, dof) < dof)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    double base[g_maxDof];
+    double step[g_maxDof];
+    for (size_t i = 0; i < dof; ++i)
+    {
+        base[i] = start.rad(i);
+        step[i] = g_worldEps * action[i]; // temporary we use global constant here for speed
+    }
+    for (size_t t = jump; t <= g_unitSize; t += jump)
+    {
+        for (size_t i = 0; i < dof; ++i)
+        {
+            _data->qpos[i] = base[i] + step[i] * t;
+        }
+        if (mj_light_collision(_model, _data))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ManipulatorPlanner::initKinematics()
+{
+    _chain = PlanarChain(_model, _data, _dof);
+}
+
+void ManipulatorPlanner::initModelLength()
+{
+    if (_model == nullptr)
+    {
+        return;
+    }
+    _modelLength = 0;
+    for (size_t i = 1; i <= _dof; ++i)
+    {
+        _modelLength += _model->geom_size[i * 3 + 1] * 2;
+    }
+    _maxActionLength = sin(g_eps / 2) * _modelLength * 2;
 }
 
 Solution ManipulatorPlanner::linearPlanning(const JointState& startPos, const JointState& goalPos)
@@ -219,21 +699,28 @@ Solution ManipulatorPlanner::linearPlanning(const JointState& startPos, const Jo
 
 Solution ManipulatorPlanner::astarPlanning(
     const JointState& startPos, const JointState& goalPos,
-    float weight, double timeLimit
+    float weight, const astar::SearchControl& control, int alg
 )
 {
     AstarChecker checker(this, goalPos);
-    Solution solution = astar::astar(startPos, checker, weight, timeLimit);
-    solution.plannerProfile = getNamedProfileInfo();
-    return solution;
+    return search(startPos, checker, weight, control, alg);
 }
 Solution ManipulatorPlanner::astarPlanning(
     const JointState& startPos, double goalX, double goalY,
-    float weight, double timeLimit
+    float weight, const astar::SearchControl& control, int alg
 )
 {
     AstarCheckerSite checker(this, goalX, goalY);
-    Solution solution = astar::astar(startPos, checker, weight, timeLimit);
+    return search(startPos, checker, weight, control, alg);
+}
+Solution ManipulatorPlanner::search(
+    const JointState& startPos, astar::IAstarChecker& checker,
+    float weight, const astar::SearchControl& control, int alg
+)
+{
+    Solution solution = alg == ALG_ASTAR_EXTERNAL ?
+        astar::externalAstar(startPos, checker, weight, control, _externalConfig) :
+        astar::astar(startPos, checker, weight, control);
     solution.plannerProfile = getNamedProfileInfo();
     return solution;
 }
@@ -247,7 +734,7 @@ ManipulatorPlanner::AstarChecker::AstarChecker(ManipulatorPlanner* planner, cons
 
 bool ManipulatorPlanner::AstarChecker::isCorrect(const JointState& state, const Action& action)
 {
-    return state.applied(action).isCorrect() && (!_planner->checkCollisionAction(state, action));
+    return _planner->isCorrect(state, action) && (!_planner->checkCollisionAction(state, action));
 }
 bool ManipulatorPlanner::AstarChecker::isGoal(const JointState& state)
 {
@@ -274,7 +761,11 @@ const Action& ManipulatorPlanner::AstarChecker::getZeroAction()
 }
 CostType ManipulatorPlanner::AstarChecker::heuristic(const JointState& state)
 {
-    return manhattanHeuristic(state, _goal);
+    return manhattanDistance(state, _goal, _planner->_limits);
+}
+const JointLimits& ManipulatorPlanner::AstarChecker::getLimits()
+{
+    return _planner->_limits;
 }
 
 // checker for site goal
@@ -289,11 +780,11 @@ ManipulatorPlanner::AstarCheckerSite::AstarCheckerSite(ManipulatorPlanner* plann
 
 bool ManipulatorPlanner::AstarCheckerSite::isCorrect(const JointState& state, const Action& action)
 {
-    return state.applied(action).isCorrect() && (!_planner->checkCollisionAction(state, action));
+    return _planner->isCorrect(state, action) && (!_planner->checkCollisionAction(state, action));
 }
 bool ManipulatorPlanner::AstarCheckerSite::isGoal(const JointState& state)
 {
-    const double r = 0.05; // const minimum dist from pos
+    const double r = g_goalRadius;
     if (state.hasCacheXY())
     {
         double dx = state.cacheX() - _goalX;
@@ -345,3 +836,7 @@ CostType ManipulatorPlanner::AstarCheckerSite::heuristic(const JointState& state
         return sqrt(dx * dx + dy * dy) / _planner->maxActionLength();
     }
 }
+const JointLimits& ManipulatorPlanner::AstarCheckerSite::getLimits()
+{
+    return _planner->_limits;
+}
@@ -0,0 +1,130 @@
+#include "portfolio.h"
+
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+double suboptimalityBound(const PlannerConfig& config)
+{
+    switch (config.alg)
+    {
+    case ALG_ASTAR:
+    case ALG_ASTAR_EXTERNAL:
+        return config.w;
+    default:
+        return std::numeric_limits<double>::infinity();
+    }
+}
+
+PortfolioPlanner::PortfolioPlanner(const ManipulatorPlanner& planner, const vector<PlannerConfig>& configs)
+{
+    if (configs.empty())
+    {
+        throw std::runtime_error("PortfolioPlanner: list of configurations is empty");
+    }
+    _configs = configs;
+    for (size_t i = 0; i < _configs.size(); ++i)
+    {
+        _workers.push_back(std::make_unique<ManipulatorPlanner>(planner));
+    }
+}
+
+vector<PlannerConfig> PortfolioPlanner::defaultConfigs()
+{
+    return {
+        {ALG_ASTAR, 1.5},
+        {ALG_ASTAR, 3.0},
+        {ALG_ASTAR, 10.0},
+    };
+}
+
+Solution PortfolioPlanner::planActions(const JointState& startPos, const JointState& goalPos,
+    double timeLimit, double suboptimality)
+{
+    return race([&startPos, &goalPos](ManipulatorPlanner& planner, const PlannerConfig& config,
+        const astar::SearchControl& control)
+    {
+        return planner.planActions(startPos, goalPos, config.alg, control, config.w);
+    }, timeLimit, suboptimality);
+}
+Solution PortfolioPlanner::planActions(const JointState& startPos, double goalX, double goalY,
+    double timeLimit, double suboptimality)
+{
+    return race([&startPos, goalX, goalY](ManipulatorPlanner& planner, const PlannerConfig& config,
+        const astar::SearchControl& control)
+    {
+        return planner.planActions(startPos, goalX, goalY, config.alg, control, config.w);
+    }, timeLimit, suboptimality);
+}
+
+const vector<PlannerConfig>& PortfolioPlanner::configs() const
+{
+    return _configs;
+}
+int PortfolioPlanner::lastWinner() const
+{
+    return _lastWinner;
+}
+
+Solution PortfolioPlanner::race(const PlanFunction& plan, double timeLimit, double suboptimality)
+{
+    astar::Clock::time_point start = astar::Clock::now();
+    astar::SearchControl control(timeLimit); // all copies share the same token
+
+    std::mutex mutex;
+    vector<Solution> results(_configs.size());
+    int winner = -1;
+
+    auto work = [&](size_t id)
+    {
+        Solution solution = plan(*_workers[id], _configs[id], control);
+        std::lock_guard<std::mutex> lock(mutex);
+        results[id] = solution;
+        bool good = solution.stats.pathVerdict == PATH_FOUND && suboptimalityBound(_configs[id]) <= suboptimality;
+        // A* is complete, so nobody will find path
+        bool proved = solution.stats.pathVerdict == PATH_NOT_EXISTS && _configs[id].alg == ALG_ASTAR;
+        if (winner == -1 && (good || proved))
+        {
+            winner = id;
+            control.token.cancel();
+        }
+    };
+    vector<std::thread> threads;
+    for (size_t id = 0; id < _configs.size(); ++id)
+    {
+        threads.emplace_back(work, id);
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    if (winner == -1)
+    {
+        // the best of found solutions
+        for (size_t id = 0; id < results.size(); ++id)
+        {
+            if (results[id].stats.pathVerdict == PATH_FOUND &&
+                (winner == -1 || results[id].stats.pathCost < results[winner].stats.pathCost))
+            {
+                winner = id;
+            }
+        }
+    }
+    if (winner == -1)
+    {
+        for (size_t id = 0; id < results.size(); ++id)
+        {
+            if (results[id].stats.pathVerdict == PATH_NOT_EXISTS)
+            {
+                winner = id;
+            }
+        }
+    }
+    _lastWinner = winner;
+
+    Solution solution = winner == -1 ? results[0] : results[winner];
+    solution.stats.runtime = std::chrono::duration<double>(astar::Clock::now() - start).count();
+    return solution;
+}
@@ -0,0 +1,119 @@
+#include "ch.h"
+#include "components.h"
+#include "cpd.h"
+#include "hpa.h"
+#include "lattice.h"
+#include "link_table.h"
+#include "roadmap.h"
+#include "rsr.h"
+
+#include <mujoco/mujoco.h>
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <memory>
+
+// offline precomputation of data which is stored next to model file
+// usage: ./precompute hpa <model.xml> [blockSize]
+//        ./precompute ch <model.xml>
+//        ./precompute cpd <model.xml>
+//        ./precompute components <model.xml>
+//        ./precompute roadmap <model.xml> [samples]
+//        ./precompute rsr <model.xml>
+//        ./precompute links <model.xml> [links]
+int main(int argc, const char** argv)
+{
+    if (argc < 3)
+    {
+        printf("Usage: %s hpa <model.xml> [blockSize]\n", argv[0]);
+        printf("       %s ch <model.xml>\n", argv[0]);
+        printf("       %s cpd <model.xml>\n", argv[0]);
+        printf("       %s components <model.xml>\n", argv[0]);
+        printf("       %s roadmap <model.xml> [samples]\n", argv[0]);
+        printf("       %s rsr <model.xml>\n", argv[0]);
+        printf("       %s links <model.xml> [links]\n", argv[0]);
+        return 1;
+    }
+    std::string kind = argv[1];
+    std::string modelFilename = argv[2];
+    // kind is checked before lattice is built and saved
+    const vector<std::string> kinds = {"hpa", "ch", "cpd", "components", "roadmap", "rsr", "links"};
+    if (std::find(kinds.begin(), kinds.end(), kind) == kinds.end())
+    {
+        printf("Unknown kind of data: %s\n", kind.c_str());
+        return 1;
+    }
+
+    char error[1000] = "Could not load binary model";
+    mjModel* model = mj_loadXML(modelFilename.c_str(), 0, error, 1000);
+    if (!model)
+    {
+        printf("Load model error: %s\n", error);
+        return 1;
+    }
+    mjData* data = mj_makeData(model);
+    ManipulatorPlanner planner(model->nq / 2, model, data);
+    uint64_t hash = modelHash(model);
+
+    // roadmap and link tables do not need lattice, so they work for any dof
+    std::shared_ptr<Lattice> lattice;
+    if (kind != "roadmap" && kind != "links")
+    {
+        lattice = std::make_shared<Lattice>(planner.dof());
+        printf("Building lattice with %zu states...\n", lattice->size());
+        lattice->build(planner);
+        lattice->save(precomputedFilename(modelFilename, "lattice"), hash);
+    }
+
+    if (kind == "hpa")
+    {
+        size_t blockSize = argc > 3 ? atoi(argv[3]) : 16;
+        HierarchicalGraph graph(lattice, blockSize);
+        graph.save(precomputedFilename(modelFilename, "hpa"), hash);
+        printf("Abstraction: %zu nodes, %zu edges.\n", graph.nodes(), graph.edges());
+    }
+    else if (kind == "ch")
+    {
+        ContractionHierarchy hierarchy(lattice);
+        hierarchy.save(precomputedFilename(modelFilename, "ch"), hash);
+        printf("Hierarchy: %zu edges, %zu shortcuts.\n", hierarchy.edges(), hierarchy.shortcuts());
+    }
+    else if (kind == "cpd")
+    {
+        CompressedPathDatabase database(lattice);
+        database.save(precomputedFilename(modelFilename, "cpd"), hash);
+        printf("Database: %zu runs.\n", database.runs());
+    }
+    else if (kind == "components")
+    {
+        ComponentMap components(*lattice, planner);
+        components.save(precomputedFilename(modelFilename, "components"), hash);
+        printf("Free space has %zu components.\n", components.components());
+    }
+    else if (kind == "roadmap")
+    {
+        size_t samples = argc > 3 ? atoi(argv[3]) : 2000;
+        Roadmap roadmap(planner, samples);
+        roadmap.save(precomputedFilename(modelFilename, "roadmap"), hash);
+        printf("Roadmap: %zu states, %zu edges.\n", roadmap.nodes(), roadmap.edges());
+    }
+    else if (kind == "rsr")
+    {
+        SymmetryReduction reduction(lattice);
+        reduction.save(precomputedFilename(modelFilename, "rsr"), hash);
+        printf("Reduction: %zu boxes, %zu states are kept.\n", reduction.boxes(), reduction.keptStates());
+    }
+    else if (kind == "links")
+    {
+        size_t links = argc > 3 ? atoi(argv[3]) : std::min(planner.dof(), LinkCollisionTable::maxLinks);
+        LinkCollisionTable table(planner, links);
+        table.save(precomputedFilename(modelFilename, "links"), hash);
+        printf("Collision tables of %zu links.\n", table.links());
+    }
+
+    mj_deleteData(data);
+    mj_deleteModel(model);
+    return 0;
+}
@@ -0,0 +1,26 @@
+#include "random.h"
+
+namespace
+{
+
+uint64_t splitmix64(uint64_t& x)
+{
+    uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+} // namespace
+
+Random::Random(uint64_t seed, uint64_t stream)
+{
+    // seed and stream are mixed separately, so near seeds and streams give unrelated states
+    uint64_t x = seed;
+    uint64_t y = splitmix64(x) ^ stream;
+    x ^= splitmix64(y);
+    for (uint64_t& word : _s)
+    {
+        word = splitmix64(x);
+    }
+}
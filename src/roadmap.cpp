@@ -0,0 +1,409 @@
+#include "roadmap.h"
+#include "lattice.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+
+// checks every world unit of straight segment
+bool checkLine(const ManipulatorPlanner& planner, JointState state, const vector<Action>& actions)
+{
+    for (const Action& action : actions)
+    {
+        if (!planner.isCorrect(state, action) || planner.checkCollisionAction(state, action, 1))
+        {
+            return false;
+        }
+        state.apply(action);
+    }
+    return true;
+}
+
+// segment of edge is checked from the state with the least index, lineActions rounds
+// differently in the other direction, so that direction is the checked segment reversed
+vector<Action> edgeActions(const vector<JointState>& states, uint32_t from, uint32_t to)
+{
+    if (from < to)
+    {
+        return lineActions(states[from], states[to]);
+    }
+    vector<Action> actions = lineActions(states[to], states[from]);
+    std::reverse(actions.begin(), actions.end());
+    for (Action& action : actions)
+    {
+        for (size_t i = 0; i < action.dof(); ++i)
+        {
+            action[i] = -action[i];
+        }
+    }
+    return actions;
+}
+
+} // namespace
+
+Roadmap::Roadmap(const ManipulatorPlanner& planner, size_t samples, size_t neighbours,
+    size_t maxEdgeDistance, size_t threads, unsigned seed)
+{
+    _dof = planner.dof();
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    vector<std::unique_ptr<ManipulatorPlanner>> checkers;
+    for (size_t id = 0; id < threads; ++id)
+    {
+        checkers.push_back(std::make_unique<ManipulatorPlanner>(planner));
+    }
+
+    // free states, attempts are limited for almost blocked scenes. Block b of candidates
+    // is generated by stream b of seed and free states are taken in order of blocks,
+    // so roadmap does not depend on the number of threads
+    const size_t blockSize = 256;
+    size_t blocks = (100 * samples + blockSize - 1) / blockSize;
+    for (size_t round = 0; round < blocks && _states.size() < samples; round += threads)
+    {
+        vector<vector<JointState>> free(std::min(threads, blocks - round));
+        auto sample = [this, round, seed, &free](const ManipulatorPlanner* checker, size_t id)
+        {
+            Random random(seed, round + id);
+            JointState candidates[blockSize];
+            randomStates(random, _dof, blockSize, candidates, checker->limits());
+            for (const JointState& state : candidates)
+            {
+                if (!checker->checkCollision(state))
+                {
+                    free[id].push_back(state);
+                }
+            }
+        };
+        vector<std::thread> workers;
+        for (size_t id = 0; id < free.size(); ++id)
+        {
+            workers.emplace_back(sample, checkers[id].get(), id);
+        }
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+        for (size_t id = 0; id < free.size() && _states.size() < samples; ++id)
+        {
+            size_t count = std::min(samples - _states.size(), free[id].size());
+            _states.insert(_states.end(), free[id].begin(), free[id].begin() + count);
+        }
+    }
+
+    // candidate edges to the nearest states
+    vector<std::pair<uint32_t, uint32_t>> candidates;
+    for (uint32_t i = 0; i < _states.size(); ++i)
+    {
+        vector<std::pair<int, uint32_t>> nearest;
+        for (uint32_t j = 0; j < _states.size(); ++j)
+        {
+            int dist = manhattanDistance(_states[i], _states[j]);
+            if (j != i && dist <= (int)maxEdgeDistance)
+            {
+                nearest.push_back({dist, j});
+            }
+        }
+        size_t count = std::min(neighbours, nearest.size());
+        std::partial_sort(nearest.begin(), nearest.begin() + count, nearest.end());
+        for (size_t k = 0; k < count; ++k)
+        {
+            candidates.push_back({std::min(i, nearest[k].second), std::max(i, nearest[k].second)});
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    // segments are checked in parallel, every thread uses its own copy of planner
+    vector<char> valid(candidates.size(), false);
+    auto work = [this, threads, &candidates, &valid](const ManipulatorPlanner* checker, size_t id)
+    {
+        for (size_t c = id; c < candidates.size(); c += threads)
+        {
+            const JointState& from = _states[candidates[c].first];
+            valid[c] = checkLine(*checker, from, edgeActions(_states, candidates[c].first, candidates[c].second));
+        }
+    };
+    vector<std::thread> workers;
+    for (size_t id = 0; id < threads; ++id)
+    {
+        workers.emplace_back(work, checkers[id].get(), id);
+    }
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    // segments are checked in one direction, plan() walks the same states in the other one
+    vector<vector<Edge>> lists(_states.size());
+    for (size_t c = 0; c < candidates.size(); ++c)
+    {
+        if (valid[c])
+        {
+            uint32_t cost = manhattanDistance(_states[candidates[c].first], _states[candidates[c].second]);
+            lists[candidates[c].first].push_back({candidates[c].second, cost});
+            lists[candidates[c].second].push_back({candidates[c].first, cost});
+        }
+    }
+    _begin.assign(1, 0);
+    for (const vector<Edge>& list : lists)
+    {
+        _edges.insert(_edges.end(), list.begin(), list.end());
+        _begin.push_back(_edges.size());
+    }
+}
+
+Roadmap::Roadmap(size_t dof, const std::string& filename, uint64_t hash)
+{
+    _dof = dof;
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("Roadmap: Could not open file " + filename);
+    }
+    try
+    {
+        readPrecomputedHeader(file, "roadmap", hash, _dof);
+        uint32_t sizes[2]; // states, edges
+        bool ok = fread(sizes, sizeof(sizes), 1, file) == 1;
+        vector<int32_t> joints(ok ? sizes[0] * _dof : 0);
+        _begin.resize(ok ? sizes[0] + 1 : 0);
+        _edges.resize(ok ? sizes[1] : 0);
+        ok = ok && fread(joints.data(), sizeof(int32_t), joints.size(), file) == joints.size();
+        ok = ok && fread(_begin.data(), sizeof(uint32_t), _begin.size(), file) == _begin.size();
+        ok = ok && fread(_edges.data(), sizeof(Edge), _edges.size(), file) == _edges.size();
+        if (!ok)
+        {
+            throw std::runtime_error("Roadmap: file " + filename + " is too short");
+        }
+        for (size_t s = 0; s < sizes[0]; ++s)
+        {
+            JointState state(_dof);
+            for (size_t i = 0; i < _dof; ++i)
+            {
+                state[i] = joints[s * _dof + i];
+            }
+            _states.push_back(state);
+        }
+    }
+    catch (...)
+    {
+        fclose(file);
+        throw;
+    }
+    fclose(file);
+}
+
+void Roadmap::save(const std::string& filename, uint64_t hash) const
+{
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("Roadmap::save: Could not open file " + filename);
+    }
+    writePrecomputedHeader(file, "roadmap", hash, _dof);
+    uint32_t sizes[2] = {(uint32_t)_states.size(), (uint32_t)_edges.size()};
+    fwrite(sizes, sizeof(sizes), 1, file);
+    vector<int32_t> joints;
+    for (const JointState& state : _states)
+    {
+        for (size_t i = 0; i < _dof; ++i)
+        {
+            joints.push_back(state[i]);
+        }
+    }
+    fwrite(joints.data(), sizeof(int32_t), joints.size(), file);
+    fwrite(_begin.data(), sizeof(uint32_t), _begin.size(), file);
+    fwrite(_edges.data(), sizeof(Edge), _edges.size(), file);
+    fclose(file);
+}
+
+Solution Roadmap::plan(ManipulatorPlanner& planner, const JointState& startPos, const JointState& goalPos,
+    const astar::SearchControl& control) const
+{
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    Solution solution(planner.primitiveActions(), Action(_dof, 0));
+    vector<Action> actions;
+
+    vector<Action> direct = lineActions(startPos, goalPos);
+    if (checkLine(planner, startPos, direct))
+    {
+        actions = direct;
+    }
+    else
+    {
+        vector<Connection> starts = connections(planner, startPos, true, control, solution.stats);
+        vector<Connection> goals = connections(planner, goalPos, false, control, solution.stats);
+        vector<const Connection*> goalOf(_states.size(), nullptr);
+        for (const Connection& connection : goals)
+        {
+            goalOf[connection.node] = &connection;
+        }
+
+        // Dijkstra from all connections of start
+        const CostType inf = std::numeric_limits<CostType>::infinity();
+        vector<CostType> dist(_states.size(), inf);
+        vector<uint32_t> parent(_states.size(), std::numeric_limits<uint32_t>::max());
+        vector<const Connection*> first(_states.size(), nullptr);
+        using QueueItem = std::pair<CostType, uint32_t>;
+        std::priority_queue<QueueItem, vector<QueueItem>, std::greater<QueueItem>> open;
+        for (const Connection& connection : starts)
+        {
+            if (connection.cost < dist[connection.node])
+            {
+                dist[connection.node] = connection.cost;
+                first[connection.node] = &connection;
+                open.push({connection.cost, connection.node});
+            }
+        }
+        CostType best = inf;
+        uint32_t last = 0;
+        while (!open.empty() && open.top().first < best)
+        {
+            CostType cost = open.top().first;
+            uint32_t current = open.top().second;
+            open.pop();
+            if (cost > dist[current])
+            {
+                continue;
+            }
+            ++solution.stats.expansions;
+            if (goalOf[current] != nullptr && cost + goalOf[current]->cost < best)
+            {
+                best = cost + goalOf[current]->cost;
+                last = current;
+            }
+            for (uint32_t i = _begin[current]; i < _begin[current + 1]; ++i)
+            {
+                const Edge& edge = _edges[i];
+                if (cost + edge.cost < dist[edge.to])
+                {
+                    dist[edge.to] = cost + edge.cost;
+                    parent[edge.to] = current;
+                    first[edge.to] = nullptr;
+                    open.push({dist[edge.to], edge.to});
+                }
+            }
+        }
+        solution.stats.maxTreeSize = solution.stats.expansions;
+
+        if (best == inf)
+        {
+            // roadmap is not complete, so we can not prove that path does not exist
+            solution.stats.pathVerdict = PATH_NOT_FOUND;
+            solution.stats.runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            return solution;
+        }
+        vector<uint32_t> nodes;
+        for (uint32_t node = last; first[node] == nullptr; node = parent[node])
+        {
+            nodes.push_back(parent[node]);
+        }
+        std::reverse(nodes.begin(), nodes.end());
+        nodes.push_back(last);
+
+        actions = first[nodes.front()]->actions;
+        for (size_t i = 0; i + 1 < nodes.size(); ++i)
+        {
+            vector<Action> segment = edgeActions(_states, nodes[i], nodes[i + 1]);
+            actions.insert(actions.end(), segment.begin(), segment.end());
+        }
+        actions.insert(actions.end(), goalOf[last]->actions.begin(), goalOf[last]->actions.end());
+    }
+
+    for (const Action& action : actions)
+    {
+        solution.addAction(action);
+        solution.stats.pathCost += action.abs();
+    }
+    solution.stats.pathVerdict = PATH_FOUND;
+    solution.stats.pathPotentialCost = manhattanHeuristic(startPos, goalPos);
+    solution.stats.runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return solution;
+}
+
+size_t Roadmap::nodes() const
+{
+    return _states.size();
+}
+size_t Roadmap::edges() const
+{
+    return _edges.size() / 2;
+}
+
+bool Roadmap::connect(ManipulatorPlanner& planner, const JointState& start, const JointState& goal,
+    const astar::SearchControl& control, vector<Action>& actions, Stats& stats) const
+{
+    actions = lineActions(start, goal);
+    if (checkLine(planner, start, actions))
+    {
+        return true;
+    }
+    astar::SearchControl local = control;
+    local.deadline = std::min(control.deadline, astar::Clock::now() +
+        std::chrono::duration_cast<astar::Clock::duration>(std::chrono::duration<double>(localTimeLimit)));
+    Solution solution = planner.planActions(start, goal, ALG_ASTAR, local);
+    stats.expansions += solution.stats.expansions;
+    if (solution.stats.pathVerdict != PATH_FOUND)
+    {
+        return false;
+    }
+    actions.clear();
+    for (size_t i = 0; i < solution.size(); ++i)
+    {
+        actions.push_back(solution.getAction(i));
+    }
+    return true;
+}
+
+vector<Roadmap::Connection> Roadmap::connections(ManipulatorPlanner& planner, const JointState& state,
+    bool toRoadmap, const astar::SearchControl& control, Stats& stats) const
+{
+    vector<std::pair<int, uint32_t>> nearest;
+    for (uint32_t node = 0; node < _states.size(); ++node)
+    {
+        int dist = manhattanDistance(state, _states[node]);
+        if (dist <= (int)maxConnectDistance)
+        {
+            nearest.push_back({dist, node});
+        }
+    }
+    size_t count = std::min(connectAttempts, nearest.size());
+    std::partial_sort(nearest.begin(), nearest.begin() + count, nearest.end());
+
+    vector<Connection> result;
+    for (size_t k = 0; k < count && !control.shouldStop(); ++k)
+    {
+        Connection connection;
+        connection.node = nearest[k].second;
+        const JointState& node = _states[connection.node];
+        bool connected = toRoadmap ?
+            connect(planner, state, node, control, connection.actions, stats) :
+            connect(planner, node, state, control, connection.actions, stats);
+        if (connected)
+        {
+            connection.cost = 0;
+            for (const Action& action : connection.actions)
+            {
+                connection.cost += action.abs();
+            }
+            result.push_back(connection);
+        }
+    }
+    return result;
+}
+
+std::shared_ptr<Roadmap> loadRoadmap(const ManipulatorPlanner& planner, const std::string& modelFilename)
+{
+    return std::make_shared<Roadmap>(planner.dof(), precomputedFilename(modelFilename, "roadmap"),
+        modelHash(planner.model()));
+}
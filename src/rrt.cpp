@@ -0,0 +1,220 @@
+#include "rrt.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+KdTree::KdTree(size_t dof)
+{
+    _dof = dof;
+}
+
+size_t KdTree::insert(const JointState& state)
+{
+    size_t id = _points.size();
+    _points.push_back(state);
+    _nodes.emplace_back();
+    if (id == 0)
+    {
+        return id;
+    }
+    int32_t node = 0;
+    for (size_t depth = 0; ; ++depth)
+    {
+        size_t axis = depth % _dof;
+        int32_t& child = state[axis] < _points[node][axis] ? _nodes[node].left : _nodes[node].right;
+        if (child < 0)
+        {
+            child = id;
+            return id;
+        }
+        node = child;
+    }
+}
+
+size_t KdTree::nearest(const JointState& state) const
+{
+    size_t best = 0;
+    int bestDistance = std::numeric_limits<int>::max();
+    vector<int> query(_dof);
+    for (size_t i = 0; i < _dof; ++i)
+    {
+        query[i] = state[i];
+    }
+    // copies of query shifted by full turn of cyclic joint
+    for (int shift : {0, -2 * g_units, 2 * g_units})
+    {
+        vector<int> shifted = query;
+        shifted[0] += shift;
+        nearest(0, 0, shifted, best, bestDistance);
+    }
+    return best;
+}
+
+size_t KdTree::size() const
+{
+    return _points.size();
+}
+const JointState& KdTree::point(size_t id) const
+{
+    return _points[id];
+}
+
+void KdTree::nearest(int32_t node, size_t depth, const vector<int>& query, size_t& best, int& bestDistance) const
+{
+    if (node < 0)
+    {
+        return;
+    }
+    const JointState& point = _points[node];
+    int distance = 0;
+    for (size_t i = 0; i < _dof; ++i)
+    {
+        distance += std::abs(query[i] - point[i]);
+    }
+    if (distance < bestDistance)
+    {
+        best = node;
+        bestDistance = distance;
+    }
+    size_t axis = depth % _dof;
+    int delta = query[axis] - point[axis];
+    int32_t nearSide = delta < 0 ? _nodes[node].left : _nodes[node].right;
+    int32_t farSide = delta < 0 ? _nodes[node].right : _nodes[node].left;
+    nearest(nearSide, depth + 1, query, best, bestDistance);
+    // distance to splitting plane is a lower bound of distance to points on the other side
+    if (std::abs(delta) < bestDistance)
+    {
+        nearest(farSide, depth + 1, query, best, bestDistance);
+    }
+}
+
+RrtConnect::RrtConnect(const ManipulatorPlanner& planner, unsigned seed) : _random(seed)
+{
+    _planner = &planner;
+}
+
+Solution RrtConnect::plan(const JointState& startPos, const JointState& goalPos, const astar::SearchControl& control)
+{
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    size_t dof = startPos.dof();
+    Solution solution(_planner->primitiveActions(), Action(dof, 0));
+
+    Tree trees[2] = {{KdTree(dof), {0}, {{}}}, {KdTree(dof), {0}, {{}}}};
+    trees[0].index.insert(startPos);
+    trees[1].index.insert(goalPos);
+
+    bool found = startPos == goalPos;
+    size_t grow = 0; // tree which is extended to random state
+    for (size_t iteration = 0; iteration < maxIterations && !found; ++iteration)
+    {
+        if (iteration % 64 == 0 && control.shouldStop())
+        {
+            break;
+        }
+        ++solution.stats.expansions;
+        JointState target = randomState(_random, dof, _planner->limits());
+        if (extend(trees[grow], target) != TRAPPED)
+        {
+            const JointState& added = trees[grow].index.point(trees[grow].index.size() - 1);
+            found = connect(trees[1 - grow], added) == REACHED;
+        }
+        if (!found)
+        {
+            grow = 1 - grow;
+        }
+    }
+    solution.stats.maxTreeSize = trees[0].index.size() + trees[1].index.size();
+
+    if (found)
+    {
+        // the last states of both trees are equal, steps of goal tree are reversed
+        vector<Action> steps;
+        for (size_t node : branch(trees[0], trees[0].index.size() - 1))
+        {
+            steps.insert(steps.end(), trees[0].steps[node].begin(), trees[0].steps[node].end());
+        }
+        vector<size_t> back = branch(trees[1], trees[1].index.size() - 1);
+        for (auto node = back.rbegin(); node != back.rend(); ++node)
+        {
+            const vector<Action>& nodeSteps = trees[1].steps[*node];
+            for (auto step = nodeSteps.rbegin(); step != nodeSteps.rend(); ++step)
+            {
+                Action reverse(dof, 0);
+                for (size_t i = 0; i < dof; ++i)
+                {
+                    reverse[i] = -(*step)[i];
+                }
+                steps.push_back(reverse);
+            }
+        }
+        JointState state = startPos;
+        for (const Action& step : steps)
+        {
+            _planner->addStep(solution, state, step);
+            state.apply(step);
+        }
+        solution.stats.pathVerdict = PATH_FOUND;
+        solution.stats.pathPotentialCost = manhattanHeuristic(startPos, goalPos);
+    }
+    solution.stats.runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return solution;
+}
+
+RrtConnect::ExtendResult RrtConnect::extend(Tree& tree, const JointState& target)
+{
+    size_t near = tree.index.nearest(target);
+    JointState state = tree.index.point(near);
+    vector<Action> steps = lineActions(state, target);
+    size_t moved = 0;
+    for (; moved < steps.size() && moved < (size_t)stepSize; ++moved)
+    {
+        if (!_planner->isCorrect(state, steps[moved]) || _planner->checkCollisionAction(state, steps[moved], 1))
+        {
+            break;
+        }
+        state.apply(steps[moved]);
+    }
+    if (moved == 0)
+    {
+        return steps.empty() ? REACHED : TRAPPED;
+    }
+    tree.index.insert(state.withoutLastAction());
+    tree.parent.push_back(near);
+    tree.steps.push_back(vector<Action>(steps.begin(), steps.begin() + moved));
+    return moved == steps.size() ? REACHED : ADVANCED;
+}
+
+RrtConnect::ExtendResult RrtConnect::connect(Tree& tree, const JointState& target)
+{
+    ExtendResult result = ADVANCED;
+    while (result == ADVANCED)
+    {
+        result = extend(tree, target);
+    }
+    // path must end in target state, so tree must have it as the last state
+    if (result == REACHED && tree.index.point(tree.index.size() - 1) != target)
+    {
+        size_t same = tree.index.nearest(target);
+        tree.index.insert(target);
+        tree.parent.push_back(same);
+        tree.steps.emplace_back();
+    }
+    return result;
+}
+
+vector<size_t> RrtConnect::branch(const Tree& tree, size_t node) const
+{
+    vector<size_t> result;
+    while (true)
+    {
+        result.push_back(node);
+        if (node == 0)
+        {
+            break;
+        }
+        node = tree.parent[node];
+    }
+    std::reverse(result.begin(), result.end());
+    return result;
+}
@@ -0,0 +1,407 @@
+#include "rsr.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+
+const uint32_t g_noBox = std::numeric_limits<uint32_t>::max();
+const int g_side = 2 * g_units;
+
+// distance by one joint, joint 0 is cyclic
+int jointDistance(int from, int to, size_t joint)
+{
+    int distance = std::abs(to - from);
+    return joint == 0 ? std::min(distance, g_side - distance) : distance;
+}
+
+} // namespace
+
+SymmetryReduction::SymmetryReduction(std::shared_ptr<const Lattice> lattice)
+{
+    _lattice = lattice;
+    size_t stride = 1;
+    for (size_t i = 0; i < _lattice->dof(); ++i)
+    {
+        _strides.push_back(stride);
+        stride *= g_side;
+    }
+    _boxOf.assign(_lattice->size(), g_noBox);
+
+    // greedy decomposition: box grows from the first free state by one layer
+    // along every joint in turn while layers are empty
+    for (size_t id = 0; id < _lattice->size(); ++id)
+    {
+        if (!_lattice->isFree(id) || _boxOf[id] != g_noBox)
+        {
+            continue;
+        }
+        Box box = {{0, 0, 0}, {0, 0, 0}};
+        for (size_t i = 0; i < _lattice->dof(); ++i)
+        {
+            box.lo[i] = box.hi[i] = coord(id, i);
+        }
+        bool grown = true;
+        while (grown)
+        {
+            grown = false;
+            for (size_t i = 0; i < _lattice->dof(); ++i)
+            {
+                if (box.hi[i] + 1 < g_side && canGrow(box, i))
+                {
+                    ++box.hi[i];
+                    grown = true;
+                }
+            }
+        }
+        assign(box, _boxes.size());
+        _boxes.push_back(box);
+    }
+}
+
+SymmetryReduction::SymmetryReduction(std::shared_ptr<const Lattice> lattice, const std::string& filename, uint64_t hash)
+{
+    _lattice = lattice;
+    size_t stride = 1;
+    for (size_t i = 0; i < _lattice->dof(); ++i)
+    {
+        _strides.push_back(stride);
+        stride *= g_side;
+    }
+    _boxOf.assign(_lattice->size(), g_noBox);
+
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("SymmetryReduction: Could not open file " + filename);
+    }
+    try
+    {
+        readPrecomputedHeader(file, "rsr", hash, _lattice->dof());
+        uint32_t count = 0;
+        bool ok = fread(&count, sizeof(count), 1, file) == 1;
+        _boxes.resize(ok ? count : 0);
+        ok = ok && fread(_boxes.data(), sizeof(Box), _boxes.size(), file) == _boxes.size();
+        if (!ok)
+        {
+            throw std::runtime_error("SymmetryReduction: file " + filename + " is too short");
+        }
+    }
+    catch (...)
+    {
+        fclose(file);
+        throw;
+    }
+    fclose(file);
+    for (size_t b = 0; b < _boxes.size(); ++b)
+    {
+        assign(_boxes[b], b);
+    }
+}
+
+void SymmetryReduction::save(const std::string& filename, uint64_t hash) const
+{
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("SymmetryReduction::save: Could not open file " + filename);
+    }
+    writePrecomputedHeader(file, "rsr", hash, _lattice->dof());
+    uint32_t count = _boxes.size();
+    fwrite(&count, sizeof(count), 1, file);
+    fwrite(_boxes.data(), sizeof(Box), _boxes.size(), file);
+    fclose(file);
+}
+
+size_t SymmetryReduction::boxes() const
+{
+    return _boxes.size();
+}
+
+size_t SymmetryReduction::keptStates() const
+{
+    size_t result = 0;
+    for (size_t id = 0; id < _boxOf.size(); ++id)
+    {
+        result += _boxOf[id] != g_noBox && !isInterior(id);
+    }
+    return result;
+}
+
+int SymmetryReduction::coord(size_t id, size_t joint) const
+{
+    return id / _strides[joint] % g_side;
+}
+
+bool SymmetryReduction::isInterior(size_t id) const
+{
+    const Box& box = _boxes[_boxOf[id]];
+    for (size_t i = 0; i < _lattice->dof(); ++i)
+    {
+        int c = coord(id, i);
+        if (c == box.lo[i] || c == box.hi[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SymmetryReduction::canGrow(const Box& box, size_t joint) const
+{
+    size_t dof = _lattice->dof();
+    Box layer = box;
+    layer.lo[joint] = layer.hi[joint] = box.hi[joint] + 1;
+    bool empty = true;
+    forEachState(layer, [&](size_t id)
+    {
+        if (!empty)
+        {
+            return;
+        }
+        size_t previous = id - _strides[joint];
+        empty = _lattice->isFree(id) && _boxOf[id] == g_noBox &&
+            _lattice->hasEdge(previous, joint) && _lattice->hasEdge(id, joint + dof);
+        for (size_t i = 0; i < dof && empty; ++i)
+        {
+            if (i != joint && coord(id, i) < box.hi[i])
+            {
+                empty = _lattice->hasEdge(id, i) && _lattice->hasEdge(id + _strides[i], i + dof);
+            }
+        }
+    });
+    return empty;
+}
+
+void SymmetryReduction::assign(const Box& box, uint32_t boxId)
+{
+    forEachState(box, [&](size_t id)
+    {
+        _boxOf[id] = boxId;
+    });
+}
+
+template <class F>
+void SymmetryReduction::forEachState(const Box& box, F f) const
+{
+    size_t dof = _lattice->dof();
+    int c[3] = {box.lo[0], box.lo[1], box.lo[2]};
+    while (true)
+    {
+        size_t id = 0;
+        for (size_t i = 0; i < dof; ++i)
+        {
+            id += c[i] * _strides[i];
+        }
+        f(id);
+        size_t i = 0;
+        for (; i < dof; ++i)
+        {
+            if (c[i] < box.hi[i])
+            {
+                ++c[i];
+                break;
+            }
+            c[i] = box.lo[i];
+        }
+        if (i == dof)
+        {
+            return;
+        }
+    }
+}
+
+Solution SymmetryReduction::plan(const JointState& startPos, const JointState& goalPos,
+    const vector<Action>& primitiveActions, const Action& zeroAction) const
+{
+    struct Node
+    {
+        uint32_t state;
+        uint32_t g;
+        uint32_t parent;
+        int8_t action; // action of lattice, -1 for move inside of box
+        bool closed;
+    };
+    struct OpenEntry
+    {
+        uint32_t f;
+        uint32_t g;
+        uint32_t node;
+
+        bool operator>(const OpenEntry& other) const
+        {
+            return f > other.f || (f == other.f && g < other.g);
+        }
+    };
+
+    Solution solution(primitiveActions, zeroAction);
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    size_t dof = _lattice->dof();
+    size_t start = _lattice->index(startPos);
+    size_t goal = _lattice->index(goalPos);
+    if (!_lattice->isFree(start) || !_lattice->isFree(goal))
+    {
+        solution.stats.pathVerdict = PATH_NOT_EXISTS;
+        return solution;
+    }
+
+    auto heuristic = [&](size_t id)
+    {
+        uint32_t h = 0;
+        for (size_t i = 0; i < dof; ++i)
+        {
+            h += jointDistance(coord(id, i), coord(goal, i), i);
+        }
+        return h;
+    };
+    // moves inside of box do not wrap cyclic joint
+    auto boxDistance = [&](size_t from, size_t to)
+    {
+        uint32_t d = 0;
+        for (size_t i = 0; i < dof; ++i)
+        {
+            d += std::abs(coord(to, i) - coord(from, i));
+        }
+        return d;
+    };
+
+    vector<Node> nodes;
+    std::unordered_map<uint32_t, uint32_t> nodeOf;
+    std::priority_queue<OpenEntry, vector<OpenEntry>, std::greater<OpenEntry>> open;
+    auto relax = [&](uint32_t parent, size_t id, uint32_t cost, int8_t action)
+    {
+        uint32_t g = nodes[parent].g + cost;
+        auto inserted = nodeOf.emplace(id, nodes.size());
+        if (inserted.second)
+        {
+            nodes.push_back({(uint32_t)id, std::numeric_limits<uint32_t>::max(), 0, -1, false});
+        }
+        Node& node = nodes[inserted.first->second];
+        if (!node.closed && g < node.g)
+        {
+            node.g = g;
+            node.parent = parent;
+            node.action = action;
+            open.push({g + heuristic(id), g, inserted.first->second});
+        }
+    };
+
+    nodes.push_back({(uint32_t)start, 0, 0, -1, false});
+    nodeOf[start] = 0;
+    open.push({heuristic(start), 0, 0});
+    uint32_t found = std::numeric_limits<uint32_t>::max();
+    while (!open.empty())
+    {
+        uint32_t current = open.top().node;
+        open.pop();
+        if (nodes[current].closed)
+        {
+            continue;
+        }
+        nodes[current].closed = true;
+        size_t id = nodes[current].state;
+        if (id == goal)
+        {
+            found = current;
+            break;
+        }
+        ++solution.stats.expansions;
+
+        const Box& box = _boxes[_boxOf[id]];
+        if (_boxOf[id] == _boxOf[goal])
+        {
+            relax(current, goal, boxDistance(id, goal), -1);
+        }
+        if (isInterior(id))
+        {
+            // only start can be inside of box, it is connected to all faces
+            for (size_t i = 0; i < dof; ++i)
+            {
+                int c = coord(id, i);
+                relax(current, id - (c - box.lo[i]) * _strides[i], c - box.lo[i], -1);
+                relax(current, id + (box.hi[i] - c) * _strides[i], box.hi[i] - c, -1);
+            }
+            continue;
+        }
+        for (size_t a = 0; a < _lattice->actions(); ++a)
+        {
+            size_t next = _lattice->neighbour(id, a);
+            if (next < _lattice->size() && _lattice->hasEdge(id, a) && !isInterior(next))
+            {
+                relax(current, next, 1, a);
+            }
+        }
+        // macro edges across box
+        for (size_t i = 0; i < dof; ++i)
+        {
+            int c = coord(id, i);
+            int width = box.hi[i] - box.lo[i];
+            if (width < 2)
+            {
+                continue;
+            }
+            if (c == box.lo[i])
+            {
+                relax(current, id + width * _strides[i], width, -1);
+            }
+            else if (c == box.hi[i])
+            {
+                relax(current, id - width * _strides[i], width, -1);
+            }
+        }
+    }
+    solution.stats.maxTreeSize = nodes.size();
+
+    if (found == std::numeric_limits<uint32_t>::max())
+    {
+        solution.stats.pathVerdict = PATH_NOT_EXISTS;
+    }
+    else
+    {
+        vector<uint32_t> path;
+        for (uint32_t node = found; node != 0; node = nodes[node].parent)
+        {
+            path.push_back(node);
+        }
+        std::reverse(path.begin(), path.end());
+        size_t from = start;
+        for (uint32_t node : path)
+        {
+            size_t to = nodes[node].state;
+            if (nodes[node].action >= 0)
+            {
+                solution.addAction(nodes[node].action);
+            }
+            else
+            {
+                for (size_t i = 0; i < dof; ++i)
+                {
+                    int delta = coord(to, i) - coord(from, i);
+                    for (int k = 0; k < std::abs(delta); ++k)
+                    {
+                        solution.addAction(delta > 0 ? i : i + dof);
+                    }
+                }
+            }
+            from = to;
+        }
+        solution.stats.pathVerdict = PATH_FOUND;
+        solution.stats.pathCost = nodes[found].g;
+        solution.stats.pathPotentialCost = heuristic(start);
+    }
+    solution.stats.runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return solution;
+}
+
+std::shared_ptr<SymmetryReduction> loadSymmetryReduction(const ManipulatorPlanner& planner, const std::string& modelFilename)
+{
+    uint64_t hash = modelHash(planner.model());
+    std::shared_ptr<Lattice> lattice = std::make_shared<Lattice>(planner.dof());
+    lattice->load(precomputedFilename(modelFilename, "lattice"), hash);
+    return std::make_shared<SymmetryReduction>(lattice, precomputedFilename(modelFilename, "rsr"), hash);
+}
@@ -0,0 +1,152 @@
+#include "smoother.h"
+
+#include <algorithm>
+#include <thread>
+
+PathSmoother::PathSmoother(const ManipulatorPlanner& planner, size_t threads) : _random(12345)
+{
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < threads; ++i)
+    {
+        _workers.push_back(std::make_unique<ManipulatorPlanner>(planner));
+    }
+}
+
+size_t PathSmoother::threads() const
+{
+    return _workers.size();
+}
+
+Solution PathSmoother::smooth(const Solution& solution, const JointState& startPos, size_t rounds, size_t candidates)
+{
+    if (solution.stats.pathVerdict != PATH_FOUND)
+    {
+        return solution;
+    }
+    startProfiling();
+    vector<Action> actions;
+    for (size_t i = 0; i < solution.size(); ++i)
+    {
+        actions.push_back(solution.getAction(i));
+    }
+
+    for (size_t round = 0; round < rounds && actions.size() >= 2; ++round)
+    {
+        vector<JointState> path = {startPos};
+        for (const Action& action : actions)
+        {
+            path.push_back(path.back().applied(action));
+        }
+
+        // the whole path is always the first candidate
+        vector<Shortcut> shortcuts = {{0, actions.size(), {}, false}};
+        for (size_t i = 1; i < candidates; ++i)
+        {
+            size_t from = _random.uniform(0, actions.size());
+            size_t to = _random.uniform(0, actions.size());
+            if (from > to)
+            {
+                std::swap(from, to);
+            }
+            if (to - from >= 2)
+            {
+                shortcuts.push_back({from, to, {}, false});
+            }
+        }
+
+        auto work = [&](size_t id)
+        {
+            for (size_t i = id; i < shortcuts.size(); i += _workers.size())
+            {
+                Shortcut& shortcut = shortcuts[i];
+                shortcut.actions = lineActions(path[shortcut.from], path[shortcut.to]);
+                shortcut.valid = shortcut.actions.size() < shortcut.to - shortcut.from &&
+                    checkShortcut(*_workers[id], path[shortcut.from], shortcut.actions);
+            }
+        };
+        vector<std::thread> threads;
+        for (size_t id = 0; id < _workers.size(); ++id)
+        {
+            threads.emplace_back(work, id);
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        // take the most profitable shortcuts which do not overlap
+        vector<Shortcut*> valid;
+        for (Shortcut& shortcut : shortcuts)
+        {
+            if (shortcut.valid)
+            {
+                valid.push_back(&shortcut);
+            }
+        }
+        std::sort(valid.begin(), valid.end(), [](const Shortcut* a, const Shortcut* b)
+        {
+            return a->to - a->from - a->actions.size() > b->to - b->from - b->actions.size();
+        });
+        vector<Shortcut*> chosen;
+        for (Shortcut* shortcut : valid)
+        {
+            bool overlaps = false;
+            for (Shortcut* other : chosen)
+            {
+                overlaps |= shortcut->from < other->to && other->from < shortcut->to;
+            }
+            if (!overlaps)
+            {
+                chosen.push_back(shortcut);
+            }
+        }
+        if (chosen.empty())
+        {
+            break;
+        }
+        std::sort(chosen.begin(), chosen.end(), [](const Shortcut* a, const Shortcut* b)
+        {
+            return a->from < b->from;
+        });
+
+        vector<Action> newActions;
+        size_t id = 0;
+        for (Shortcut* shortcut : chosen)
+        {
+            newActions.insert(newActions.end(), actions.begin() + id, actions.begin() + shortcut->from);
+            newActions.insert(newActions.end(), shortcut->actions.begin(), shortcut->actions.end());
+            id = shortcut->to;
+        }
+        newActions.insert(newActions.end(), actions.begin() + id, actions.end());
+        actions = newActions;
+    }
+
+    Solution result(solution.primitiveActions(), solution.zeroAction());
+    result.stats = solution.stats;
+    result.plannerProfile = solution.plannerProfile;
+    result.searchTreeProfile = solution.searchTreeProfile;
+    result.stats.pathCost = 0;
+    for (const Action& action : actions)
+    {
+        result.addAction(action);
+        result.stats.pathCost += action.abs();
+    }
+    stopProfiling();
+    return result;
+}
+
+bool PathSmoother::checkShortcut(const ManipulatorPlanner& planner, JointState state, const vector<Action>& actions) const
+{
+    for (const Action& action : actions)
+    {
+        if (!planner.isCorrect(state, action) || planner.checkCollisionAction(state, action, 1))
+        {
+            return false;
+        }
+        state.apply(action);
+    }
+    return true;
+}
@@ -24,6 +24,36 @@ void Solution::addAction(size_t stepId)
 {
     _solveActions.push_back(stepId);
 }
+void Solution::addAction(const Action& action)
+{
+    for (size_t i = 0; i < _primitiveActions.size(); ++i)
+    {
+        if (manhattanDistance(_primitiveActions[i], action) == 0)
+        {
+            addAction(i);
+            return;
+        }
+    }
+    _primitiveActions.push_back(action);
+    addAction(_primitiveActions.size() - 1);
+}
+
+size_t Solution::size() const
+{
+    return _solveActions.size();
+}
+const Action& Solution::getAction(size_t i) const
+{
+    return _primitiveActions[_solveActions[i]];
+}
+const vector<Action>& Solution::primitiveActions() const
+{
+    return _primitiveActions;
+}
+const Action& Solution::zeroAction() const
+{
+    return _zeroAction;
+}
 
 bool Solution::goalAchieved() const
 {
@@ -76,13 +76,16 @@ void TaskSet::loadTasks(const std::string& filename, TaskType type)
             JointState start(dof);
             JointState goal(dof);
             int counter_scanned = 0;
+            int value = 0;
             for (size_t i = 0; i < dof; ++i)
             {
-                counter_scanned += fscanf(file, "%d", &start[i]);
+                counter_scanned += fscanf(file, "%d", &value);
+                start[i] = value;
             }
             for (size_t i = 0; i < dof; ++i)
             {
-                counter_scanned += fscanf(file, "%d", &goal[i]);
+                counter_scanned += fscanf(file, "%d", &value);
+                goal[i] = value;
             }
             float optimal;
             counter_scanned += fscanf(file, "%f", &optimal); // it is really unused now
@@ -98,9 +101,11 @@ void TaskSet::loadTasks(const std::string& filename, TaskType type)
         {
             JointState start(dof);
             int counter_scanned = 0;
+            int value = 0;
             for (size_t i = 0; i < dof; ++i)
             {
-                counter_scanned += fscanf(file, "%d", &start[i]);
+                counter_scanned += fscanf(file, "%d", &value);
+                start[i] = value;
             }
             double goalX, goalY;
             counter_scanned += fscanf(file, "%lf%lf", &goalX, &goalY);
@@ -116,12 +121,13 @@ void TaskSet::loadTasks(const std::string& filename, TaskType type)
 }
 void TaskSet::generateRandomTasks(size_t n, TaskType type, size_t seed)
 {
-    srand(seed);
+    Random random(seed);
     if (type == TASK_STATE)
     {
         for (size_t i = 0; i < n; ++i)
         {
-            _tasks.push_back(std::make_unique<TaskState>(randomState(_dof, g_units), randomState(_dof, g_units)));
+            JointState start = randomState(random, _dof);
+            _tasks.push_back(std::make_unique<TaskState>(start, randomState(random, _dof)));
         }
     }
     else if (type == TASK_POSITION)
@@ -129,9 +135,10 @@ void TaskSet::generateRandomTasks(size_t n, TaskType type, size_t seed)
         const double bound = 2.0;
         for (size_t i = 0; i < n; ++i)
         {
-            double x = (double)rand() / RAND_MAX * 2 * bound - bound;
-            double y = (double)rand() / RAND_MAX * 2 * bound - bound;
-            _tasks.push_back(std::make_unique<TaskPosition>(randomState(_dof, g_units), x, y));
+            JointState start = randomState(random, _dof);
+            double x = random.uniform01() * 2 * bound - bound;
+            double y = random.uniform01() * 2 * bound - bound;
+            _tasks.push_back(std::make_unique<TaskPosition>(start, x, y));
         }
     }
 }
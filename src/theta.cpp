@@ -0,0 +1,179 @@
+#include "theta.h"
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+namespace
+{
+
+struct OpenEntry
+{
+    CostType f;
+    CostType g;
+    size_t id;
+
+    bool operator>(const OpenEntry& other) const
+    {
+        return f > other.f || (f == other.f && g < other.g);
+    }
+};
+
+} // namespace
+
+CostType euclideanDistance(const JointState& state1, const JointState& state2)
+{
+    Action diff = difference(state1, state2);
+    double sum = 0;
+    for (size_t i = 0; i < diff.dof(); ++i)
+    {
+        sum += (double)diff[i] * diff[i];
+    }
+    return std::sqrt(sum);
+}
+
+ThetaStar::ThetaStar(const ManipulatorPlanner& planner)
+{
+    _planner = &planner;
+}
+
+Solution ThetaStar::plan(const JointState& startPos, const JointState& goalPos,
+    const astar::SearchControl& control, double weight)
+{
+    auto begin = std::chrono::steady_clock::now();
+    size_t dof = _planner->dof();
+    const vector<Action>& actions = _planner->primitiveActions();
+    Solution solution(actions, Action(dof, 0));
+    _nodes.clear();
+    _ids.clear();
+
+    std::priority_queue<OpenEntry, vector<OpenEntry>, std::greater<OpenEntry>> open;
+    size_t start = node(startPos);
+    _nodes[start].g = 0;
+    open.push({(CostType)(weight * euclideanDistance(startPos, goalPos)), 0, start});
+    size_t goal = std::numeric_limits<size_t>::max();
+    while (!open.empty())
+    {
+        OpenEntry entry = open.top();
+        open.pop();
+        size_t id = entry.id;
+        if (_nodes[id].closed || entry.g != _nodes[id].g)
+        {
+            continue;
+        }
+        if (control.shouldStop(solution.stats.expansions))
+        {
+            break;
+        }
+        ++solution.stats.expansions;
+
+        // lazy check of segment from parent, on failure the best expanded neighbour is parent
+        size_t parent = _nodes[id].parent;
+        if (parent != id && !lineOfSight(_nodes[parent].state, _nodes[id].state))
+        {
+            _nodes[id].g = std::numeric_limits<CostType>::max();
+            for (size_t k = 0; k < actions.size(); ++k)
+            {
+                JointState near = _nodes[id].state.applied(actions[k]);
+                auto neighbour = _planner->isCorrect(_nodes[id].state, actions[k]) ? _ids.find(near.toKey()) : _ids.end();
+                if (neighbour == _ids.end() || !_nodes[neighbour->second].closed)
+                {
+                    continue;
+                }
+                const Node& from = _nodes[neighbour->second];
+                const Action& back = actions[(k + dof) % actions.size()];
+                if (from.g + back.abs() < _nodes[id].g && !_planner->checkCollisionAction(from.state, back))
+                {
+                    _nodes[id].g = from.g + back.abs();
+                    _nodes[id].parent = neighbour->second;
+                }
+            }
+        }
+        _nodes[id].closed = true;
+        if (_nodes[id].state == goalPos)
+        {
+            goal = id;
+            break;
+        }
+
+        parent = _nodes[id].parent;
+        for (const Action& action : actions)
+        {
+            JointState next = _nodes[id].state.applied(action);
+            auto known = _ids.find(next.toKey());
+            if ((known != _ids.end() && _nodes[known->second].closed) || !_planner->isCorrect(_nodes[id].state, action) ||
+                _planner->checkCollisionAction(_nodes[id].state, action))
+            {
+                continue;
+            }
+            size_t nextId = node(next);
+            // long segments are expensive to check, so new segment starts in expanded state
+            size_t from = manhattanDistance(_nodes[parent].state, next) > maxSegment ? id : parent;
+            CostType g = _nodes[from].g + euclideanDistance(_nodes[from].state, next);
+            if (g < _nodes[nextId].g)
+            {
+                _nodes[nextId].g = g;
+                _nodes[nextId].parent = from;
+                open.push({(CostType)(g + weight * euclideanDistance(next, goalPos)), g, nextId});
+            }
+        }
+    }
+    solution.stats.maxTreeSize = _nodes.size();
+
+    if (goal != std::numeric_limits<size_t>::max())
+    {
+        vector<size_t> corners;
+        for (size_t id = goal; ; id = _nodes[id].parent)
+        {
+            corners.push_back(id);
+            if (_nodes[id].parent == id)
+            {
+                break;
+            }
+        }
+        JointState state = startPos;
+        for (size_t k = corners.size() - 1; k > 0; --k)
+        {
+            for (const Action& step : lineActions(_nodes[corners[k]].state, _nodes[corners[k - 1]].state))
+            {
+                _planner->addStep(solution, state, step);
+                state.apply(step);
+            }
+        }
+        solution.stats.pathVerdict = PATH_FOUND;
+        solution.stats.pathCost = _nodes[goal].g;
+        solution.stats.pathPotentialCost = euclideanDistance(startPos, goalPos);
+    }
+    else if (open.empty())
+    {
+        solution.stats.pathVerdict = PATH_NOT_EXISTS;
+    }
+    solution.stats.runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return solution;
+}
+
+size_t ThetaStar::node(const JointState& state)
+{
+    auto inserted = _ids.emplace(state.toKey(), _nodes.size());
+    if (inserted.second)
+    {
+        size_t id = _nodes.size();
+        _nodes.push_back({state.withoutLastAction(), std::numeric_limits<CostType>::max(), id, false});
+    }
+    return inserted.first->second;
+}
+
+bool ThetaStar::lineOfSight(const JointState& from, const JointState& to) const
+{
+    JointState state = from;
+    for (const Action& step : lineActions(from, to))
+    {
+        if (!_planner->isCorrect(state, step) || _planner->checkCollisionAction(state, step, 1))
+        {
+            return false;
+        }
+        state.apply(step);
+    }
+    return true;
+}
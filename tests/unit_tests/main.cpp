@@ -4,8 +4,109 @@
 #include "taskset.h"
 #include "planner.h"
 #include "astar.h"
+#include "smoother.h"
+#include "portfolio.h"
+#include "lattice.h"
+#include "hpa.h"
+#include "ch.h"
+#include "cpd.h"
+#include "components.h"
+#include "experience.h"
+#include "roadmap.h"
+#include "rrt.h"
+#include "optimizer.h"
+#include "theta.h"
+#include "multi_arm.h"
+#include "rsr.h"
+#include "joint_kernels.h"
+#include "link_table.h"
 
 #include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+
+// model with its data, both are deleted at the end of test
+class TestModel
+{
+public:
+    explicit TestModel(const std::string& filename)
+    {
+        load(filename);
+    }
+    // copy of model file where the first occurrence of every edit.first is replaced by edit.second
+    TestModel(const std::string& filename, const vector<std::pair<std::string, std::string>>& edits);
+    ~TestModel()
+    {
+        for (mjData* extra : _extra)
+        {
+            mj_deleteData(extra);
+        }
+        mj_deleteData(data);
+        mj_deleteModel(model);
+    }
+    TestModel(const TestModel&) = delete;
+    TestModel& operator=(const TestModel&) = delete;
+
+    // one more data of model, for reference computations
+    mjData* makeData()
+    {
+        _extra.push_back(mj_makeData(model));
+        return _extra.back();
+    }
+
+    mjModel* model = nullptr;
+    mjData* data = nullptr;
+
+private:
+    void load(const std::string& filename)
+    {
+        char error[1000] = "";
+        model = mj_loadXML(filename.c_str(), 0, error, 1000);
+        REQUIRE_MESSAGE(model != nullptr, error);
+        data = mj_makeData(model);
+    }
+
+    vector<mjData*> _extra;
+};
+
+// unique file in temporary directory, it is removed at the end of test
+struct TempFile
+{
+    explicit TempFile(const std::string& suffix = "")
+    {
+        path = (std::filesystem::temp_directory_path() / "manipulator_test_XXXXXX").string() + suffix;
+        int fd = mkstemps(&path[0], suffix.size());
+        REQUIRE(fd >= 0);
+        close(fd);
+    }
+    ~TempFile()
+    {
+        std::remove(path.c_str());
+    }
+    TempFile(const TempFile&) = delete;
+    TempFile& operator=(const TempFile&) = delete;
+
+    std::string path;
+};
+
+TestModel::TestModel(const std::string& filename, const vector<std::pair<std::string, std::string>>& edits)
+{
+    std::ifstream in(filename);
+    REQUIRE(in);
+    std::string xml((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    for (const auto& edit : edits)
+    {
+        size_t pos = xml.find(edit.first);
+        REQUIRE(pos != std::string::npos);
+        xml.replace(pos, edit.first.size(), edit.second);
+    }
+    TempFile file(".xml");
+    std::ofstream(file.path) << xml;
+    load(file.path);
+}
 
 TEST_CASE("JointState comparation")
 {
@@ -39,10 +140,10 @@ void testPlanningFromTo(JointState a, JointState b, int alg)
 // test row of empty plane scenarios
 void testStressPlanning(int dof, int alg)
 {
-    srand(57283);
+    Random random(57283);
     ManipulatorPlanner planner(dof);
     JointState a(dof, 0);
-    JointState b = randomState(dof);
+    JointState b = randomState(random, dof);
     for (size_t i = 0; i < 20; ++i)
     {
         Solution solution = planner.planActions(a, b, alg);
@@ -51,7 +152,7 @@ void testStressPlanning(int dof, int alg)
             a.apply(solution.nextAction());
         }
         CHECK(a == b);
-        b = randomState(dof);
+        b = randomState(random, dof);
     }
 }
 
@@ -85,6 +186,16 @@ TEST_CASE("A* planner on empty plane")
     testStressPlanning(4, ALG_ASTAR);
 }
 
+TEST_CASE("External memory A* planner on empty plane")
+{
+    testPlanningFromTo({0, 0}, {0, 0}, ALG_ASTAR_EXTERNAL);
+    testPlanningFromTo({1, 2}, {3, -4}, ALG_ASTAR_EXTERNAL);
+    testPlanningFromTo({5}, {-1}, ALG_ASTAR_EXTERNAL);
+    testPlanningFromTo({5, 5, 5}, {-1, -1, -1}, ALG_ASTAR_EXTERNAL);
+    testStressPlanning(2, ALG_ASTAR_EXTERNAL);
+    testStressPlanning(3, ALG_ASTAR_EXTERNAL);
+}
+
 TEST_CASE("A* Nodes has operators")
 {
     astar::SearchNode node1(1, 0, JointState(1, 0));
@@ -133,3 +244,1092 @@ TEST_CASE("File read test")
     testReadFile(2, "tests/unit_tests/samples/load_taskset/2-dof_pos_test_3.scen", 2, TASK_POSITION);
     testReadFile(3, "tests/unit_tests/samples/load_taskset/3-dof_test_4.scen", 4, TASK_STATE);
 }
+
+TEST_CASE("Line actions")
+{
+    JointState a({0, 5, -3});
+    JointState b({7, -2, -3});
+    vector<Action> line = lineActions(a, b);
+    CHECK(line.size() == 7);
+    for (const Action& action : line)
+    {
+        CHECK(action.abs() <= 3);
+        a.apply(action);
+    }
+    CHECK(a == b);
+    // joint 0 goes through the border
+    JointState c({g_units - 2, 0});
+    JointState d({-g_units + 1, 0});
+    CHECK(lineActions(c, d).size() == 3);
+}
+
+TEST_CASE("Inline joint storage")
+{
+    CHECK(std::is_trivially_copyable<JointState>::value);
+    CHECK(std::is_trivially_copyable<Action>::value);
+    JointState a({g_units - 1, -g_units, 5});
+    JointState b = a;
+    b[2] = 6;
+    CHECK(a[2] == 5);
+    CHECK(b > a);
+    CHECK(b.applied(Action({0, 0, -1})) == a);
+    Action step({2 * g_units, -2 * g_units});
+    CHECK(step[0] == 2 * g_units);
+    CHECK(step[1] == -2 * g_units);
+    CHECK_THROWS(JointState(g_maxDof + 1));
+    CHECK_THROWS(Action(g_maxDof + 1));
+}
+
+TEST_CASE("Stored states do not keep actions of destroyed solutions")
+{
+    // state applies actions of solution which is destroyed before the next plan,
+    // so searches must not read its last action (heap-use-after-free under ASan)
+    ManipulatorPlanner planner(2);
+    JointState current({0, 0});
+    {
+        Solution solution = planner.planActions(current, JointState({10, -10}), ALG_ASTAR);
+        REQUIRE(solution.stats.pathVerdict == PATH_FOUND);
+        while (!solution.goalAchieved())
+        {
+            current.apply(solution.nextAction());
+        }
+    }
+    CHECK(current.lastAction() != nullptr);
+    CHECK(current.withoutLastAction().lastAction() == nullptr);
+    CHECK(current.withoutLastAction() == current);
+    CHECK(planner.planActions(current, JointState({20, 0}), ALG_ASTAR).stats.pathVerdict == PATH_FOUND);
+
+    TestModel test("model/2-dof/manipulator_5.xml");
+    ManipulatorPlanner modelPlanner(2, test.model, test.data);
+    ExperienceCache cache(modelPlanner, 2);
+    JointState start({10, 100});
+    {
+        Solution solution = cache.planActions(start, JointState({60, -100}), 10.0);
+        REQUIRE(solution.stats.pathVerdict == PATH_FOUND);
+        while (!solution.goalAchieved())
+        {
+            start.apply(solution.nextAction());
+        }
+    }
+    // the new task is connected by A* from the state above
+    Solution solution = cache.planActions(start, JointState({60, -98}), 10.0);
+    CHECK(solution.stats.pathVerdict == PATH_FOUND);
+}
+
+TEST_CASE("Packed state keys")
+{
+    Random random;
+    for (size_t dof = 1; dof <= g_maxDof; ++dof)
+    {
+        for (int k = 0; k < 100; ++k)
+        {
+            JointState state = randomState(random, dof);
+            CHECK(JointState::fromKey(state.toKey(), dof) == state);
+        }
+    }
+    JointState a({-g_units, g_units - 1, 0});
+    JointState b = a;
+    b[0] = g_units; // is not normalized by operator[]
+    CHECK(b.toKey() == a.toKey());
+    CHECK(JointState({1, 2}).toKey() != JointState({2, 1}).toKey());
+    CHECK(hashKey(a.toKey()) != hashKey(a.toKey() + 1));
+}
+
+TEST_CASE("SIMD joint kernels agree with scalar code")
+{
+    const size_t dof = 5;
+    ManipulatorPlanner planner(dof);
+    vector<Action> actions = planner.primitiveActions();
+    actions.push_back(Action({2 * g_units, -3, 0, 1, 0}));
+    actions.push_back(Action({-2 * g_units, 0, 5, 0, -1}));
+    vector<JointState> states = {JointState({g_units - 1, g_units - 1, -g_units, 0, 3})};
+    Random random;
+    for (int k = 0; k < 200; ++k)
+    {
+        states.push_back(randomState(random, dof));
+    }
+    const JointKernels* scalar = supportedJointKernels()[0];
+    for (const JointKernels* kernels : supportedJointKernels())
+    {
+        INFO(kernels->name);
+        for (const JointState& state : states)
+        {
+            JointValue out[2 * g_maxDof][g_maxDof];
+            uint32_t correct = kernels->addBatch(state.data(), actions[0].data(), sizeof(Action), actions.size(),
+                out[0], sizeof(out[0]), defaultJointLimits());
+            for (size_t k = 0; k < actions.size(); ++k)
+            {
+                JointState expected = state.applied(actions[k]);
+                for (size_t i = 0; i < dof; ++i)
+                {
+                    CHECK(out[k][i] == expected[i]);
+                }
+                bool inLimits = expected.minJoint() >= -g_units && expected.maxJoint() < g_units;
+                CHECK(bool(correct >> k & 1) == inLimits);
+                CHECK(kernels->inLimits(expected.data(), defaultJointLimits()) == inLimits);
+            }
+            CHECK(kernels->manhattan(state.data(), states[0].data(), defaultJointLimits()) ==
+                scalar->manhattan(state.data(), states[0].data(), defaultJointLimits()));
+        }
+    }
+    JointState successors[2 * g_maxDof];
+    uint32_t correct = appliedBatch(states[0], actions.data(), actions.size(), successors);
+    CHECK(successors[0] == states[0].applied(actions[0]));
+    CHECK(successors[0].lastAction() == &actions[0]);
+    CHECK((correct & 1) == 1); // joint 0 wraps
+    CHECK((correct >> 1 & 1) == 0); // joint 1 goes out of limits
+}
+
+TEST_CASE("Joint limits and steps from model")
+{
+    TestModel test("model/2-dof/manipulator_6.xml");
+    ManipulatorPlanner planner(2, test.model, test.data);
+
+    const JointLimits& limits = planner.limits();
+    CHECK(limits.low[0] == -96);
+    CHECK(limits.high[0] == 96);
+    CHECK(limits.period[0] == 0); // limited joint 0 is not cyclic
+    CHECK(limits.low[1] == -80);
+    CHECK(limits.high[1] == 80);
+    CHECK(limits.step[0] == 1);
+    CHECK(limits.step[1] == 2);
+    CHECK(planner.primitiveActions()[1][1] == 2);
+    CHECK(planner.primitiveActions()[3][1] == -2);
+    CHECK(!planner.isCorrect(JointState({96, 0}), Action({1, 0})));
+    CHECK(planner.isCorrect(JointState({96, 0}), Action({-1, 0})));
+
+    // kernels agree with scalar code under limits of model
+    Random random;
+    const JointKernels* scalar = supportedJointKernels()[0];
+    for (const JointKernels* kernels : supportedJointKernels())
+    {
+        INFO(kernels->name);
+        for (int k = 0; k < 100; ++k)
+        {
+            JointState state = randomState(random, 2);
+            JointValue out[2 * g_maxDof][g_maxDof];
+            const vector<Action>& actions = planner.primitiveActions();
+            uint32_t correct = kernels->addBatch(state.data(), actions[0].data(), sizeof(Action), actions.size(),
+                out[0], sizeof(out[0]), limits);
+            for (size_t a = 0; a < actions.size(); ++a)
+            {
+                JointState next = state.applied(actions[a]);
+                bool inLimits = next[0] >= limits.low[0] && next[0] <= limits.high[0] &&
+                    next[1] >= limits.low[1] && next[1] <= limits.high[1] && std::abs(next[0] - state[0]) <= 1;
+                CHECK(bool(correct >> a & 1) == inLimits);
+            }
+            CHECK(kernels->inLimits(state.data(), limits) == scalar->inLimits(state.data(), limits));
+            JointState other = randomState(random, 2);
+            CHECK(kernels->manhattan(state.data(), other.data(), limits) ==
+                scalar->manhattan(state.data(), other.data(), limits));
+        }
+    }
+
+    // goal off grid of steps or out of limits
+    CHECK(planner.planActions(JointState({0, 0}), JointState({10, 11}), ALG_ASTAR).stats.pathVerdict == PATH_NOT_EXISTS);
+    CHECK(planner.planActions(JointState({0, 0}), JointState({120, 10}), ALG_ASTAR).stats.pathVerdict == PATH_NOT_EXISTS);
+    CHECK(planner.planActions(JointState({0, 0}), JointState({10, 90}), ALG_ASTAR).stats.pathVerdict == PATH_NOT_EXISTS);
+
+    JointState start({90, 0});
+    JointState goal({-90, 20});
+    Solution solution = planner.planActions(start, goal, ALG_ASTAR, 10.0);
+    REQUIRE(solution.stats.pathVerdict == PATH_FOUND);
+    CHECK(solution.stats.pathCost >= 180 + 20); // joint 0 does not go around the border
+    JointState current = start;
+    while (!solution.goalAchieved())
+    {
+        const Action& action = solution.nextAction();
+        CHECK(planner.isCorrect(current, action));
+        current.apply(action);
+        CHECK(current[1] % 2 == 0);
+    }
+    CHECK(current == goal);
+}
+
+TEST_CASE("Random streams and batch random states")
+{
+    Random first(7, 0);
+    Random same(7, 0);
+    Random other(7, 1);
+    bool differs = false;
+    for (int k = 0; k < 100; ++k)
+    {
+        uint64_t value = first();
+        CHECK(value == same());
+        differs |= value != other();
+    }
+    CHECK(differs);
+
+    TestModel test("model/2-dof/manipulator_6.xml");
+    ManipulatorPlanner planner(2, test.model, test.data);
+
+    const size_t count = 1000;
+    vector<JointState> states(count);
+    Random batch(11);
+    randomStates(batch, 2, count, states.data(), planner.limits());
+    Random single(11);
+    int minJoint = g_units;
+    int maxJoint = -g_units;
+    for (const JointState& state : states)
+    {
+        CHECK(state == randomState(single, 2, planner.limits()));
+        CHECK(planner.isCorrect(state));
+        CHECK(state[1] % 2 == 0);
+        minJoint = std::min(minJoint, state[0]);
+        maxJoint = std::max(maxJoint, state[0]);
+    }
+    CHECK(minJoint < -90);
+    CHECK(maxJoint > 90);
+
+    // no multiple of step 4 in [5, 6]
+    JointLimits narrow;
+    narrow.low[1] = 5;
+    narrow.high[1] = 6;
+    narrow.step[1] = 4;
+    CHECK_THROWS(randomState(batch, 2, narrow));
+    TestModel narrowModel("model/2-dof/manipulator_6.xml",
+        {{"data=\"1 2\"", "data=\"1 4\""}, {"range=\"-112.5 112.5\"", "range=\"7 8.5\""}}); // units 5 and 6
+    CHECK_THROWS(ManipulatorPlanner(2, narrowModel.model, narrowModel.data));
+}
+
+TEST_CASE("Planar chain kinematics agrees with mujoco")
+{
+    vector<std::pair<std::string, size_t>> models = {
+        {"model/1-dof/manipulator_4.xml", 1},
+        {"model/2-dof/manipulator_1.xml", 2},
+        {"model/2-dof/manipulator_6.xml", 2},
+        {"model/3-dof/manipulator_4.xml", 3},
+        {"model/4-dof/manipulator_4.xml", 4},
+    };
+    Random random(31);
+    for (const auto& entry : models)
+    {
+        INFO(entry.first);
+        TestModel test(entry.first);
+        mjModel* model = test.model;
+        mjData* native = test.data;
+        mjData* reference = test.makeData();
+        PlanarChain chain(model, native, entry.second);
+        REQUIRE(chain.supported());
+        CHECK(chain.sitesSupported());
+        ManipulatorPlanner planner(entry.second, model, native);
+        for (int k = 0; k < 50; ++k)
+        {
+            JointState state = randomState(random, entry.second);
+            int angles[g_maxDof];
+            for (size_t i = 0; i < entry.second; ++i)
+            {
+                // sub-step of action, angle is not multiple of planner unit
+                angles[i] = state[i] * g_unitSize + k % g_unitSize;
+                reference->qpos[i] = angles[i] * g_worldEps;
+            }
+            chain.kinematics(native, angles);
+            mj_kinematics(model, reference);
+            for (int g = 0; g < 3 * model->ngeom; ++g)
+            {
+                CHECK(native->geom_xpos[g] == doctest::Approx(reference->geom_xpos[g]).epsilon(1e-9));
+            }
+            for (int g = 0; g < 9 * model->ngeom; ++g)
+            {
+                CHECK(native->geom_xmat[g] == doctest::Approx(reference->geom_xmat[g]).epsilon(1e-9));
+            }
+            for (int site = 0; site < 3 * model->nsite; ++site)
+            {
+                CHECK(native->site_xpos[site] == doctest::Approx(reference->site_xpos[site]).epsilon(1e-9));
+            }
+
+            for (size_t i = 0; i < entry.second; ++i)
+            {
+                reference->qpos[i] = state.rad(i);
+            }
+            CHECK(planner.checkCollision(state) == mj_light_collision(model, reference));
+            std::pair<double, double> site = planner.sitePosition(state);
+            CHECK(site == planner.sitePosition(state)); // table gives the same bits every time
+            if (model->nsite > 0)
+            {
+                CHECK(site.first == doctest::Approx(reference->site_xpos[0]).epsilon(1e-9));
+                CHECK(site.second == doctest::Approx(reference->site_xpos[1]).epsilon(1e-9));
+            }
+        }
+    }
+
+    // links of the other arm collide, so the whole model is computed by mujoco
+    TestModel arms("model/2-arms/manipulator_2.xml");
+    CHECK(!PlanarChain(arms.model, arms.data, 2).supported());
+}
+
+TEST_CASE("Incremental collision checks of successors")
+{
+    TestModel test("model/4-dof/manipulator_4.xml");
+    mjData* reference = test.makeData();
+    ManipulatorPlanner planner(4, test.model, test.data);
+
+    // full kinematics of every sub-step
+    auto collides = [&test, reference](const JointState& start, const Action& action)
+    {
+        for (int t = 1; t <= g_unitSize; ++t)
+        {
+            for (size_t i = 0; i < start.dof(); ++i)
+            {
+                reference->qpos[i] = (start[i] * g_unitSize + action[i] * t) * g_worldEps;
+            }
+            if (mj_light_collision(test.model, reference))
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+    Random random(41);
+    size_t collisions = 0;
+    for (int k = 0; k < 300; ++k)
+    {
+        JointState start = randomState(random, 4);
+        // successors in order of expansion, then in random order mixed with other checks
+        for (const Action& action : planner.primitiveActions())
+        {
+            bool expected = collides(start, action);
+            CHECK(planner.checkCollisionAction(start, action, 1) == expected);
+            collisions += expected;
+        }
+        for (int j = 0; j < 4; ++j)
+        {
+            const Action& action = planner.primitiveActions()[random.uniform(0, 7)];
+            CHECK(planner.checkCollisionAction(start, action, 1) == collides(start, action));
+            if (j == 2)
+            {
+                planner.checkCollision(randomState(random, 4));
+            }
+        }
+        Action diagonal({1, 0, -1, 1});
+        CHECK(planner.checkCollisionAction(start, diagonal, 1) == collides(start, diagonal));
+    }
+    CHECK(collisions > 0);
+}
+
+TEST_CASE("Collision tables of the first links")
+{
+    TestModel test("model/4-dof/manipulator_4.xml");
+    mjData* reference = test.makeData();
+    ManipulatorPlanner planner(4, test.model, test.data);
+    CHECK_THROWS(LinkCollisionTable(planner, 4));
+
+    LinkCollisionTable table(planner, 2, 3);
+    TempFile saved;
+    uint64_t hash = modelHash(test.model);
+    table.save(saved.path, hash);
+    std::shared_ptr<LinkCollisionTable> loaded = std::make_shared<LinkCollisionTable>(4, saved.path, hash);
+    CHECK_THROWS(LinkCollisionTable(4, saved.path, hash + 1));
+    REQUIRE(loaded->links() == 2);
+    ManipulatorPlanner tabled(planner);
+    tabled.setLinkCollisionTable(loaded);
+
+    auto collides = [&test, reference](const JointState& start, const Action& action, int jump)
+    {
+        for (int t = jump; t <= g_unitSize; t += jump)
+        {
+            for (size_t i = 0; i < start.dof(); ++i)
+            {
+                reference->qpos[i] = (start[i] * g_unitSize + action[i] * t) * g_worldEps;
+            }
+            if (mj_light_collision(test.model, reference))
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+    Random random(43);
+    size_t collisions = 0;
+    for (int k = 0; k < 300; ++k)
+    {
+        JointState start = randomState(random, 4);
+        bool expected = collides(start, Action(4, 0), g_unitSize);
+        CHECK(tabled.checkCollision(start) == expected);
+        collisions += expected;
+        // successors in order of expansion, the ends are looked up, then every sub-step
+        for (const Action& action : planner.primitiveActions())
+        {
+            CHECK(tabled.checkCollisionAction(start, action) == collides(start, action, g_unitSize));
+        }
+        for (const Action& action : planner.primitiveActions())
+        {
+            CHECK(tabled.checkCollisionAction(start, action, 1) == collides(start, action, 1));
+        }
+    }
+    CHECK(collisions > 0);
+}
+
+TEST_CASE("Path smoothing")
+{
+    TestModel test("model/2-dof/manipulator_5.xml");
+    ManipulatorPlanner planner(2, test.model, test.data);
+    PathSmoother smoother(planner, 4);
+
+    JointState start({10, 100});
+    JointState goal({60, -100});
+    Solution solution = planner.planActions(start, goal, ALG_ASTAR, 10.0, 100.0);
+    REQUIRE(solution.stats.pathVerdict == PATH_FOUND);
+    Solution smoothed = smoother.smooth(solution, start);
+    CHECK(smoothed.stats.pathVerdict == PATH_FOUND);
+    CHECK(smoothed.size() <= solution.size());
+    CHECK(smoothed.stats.pathCost <= solution.stats.pathCost);
+
+    JointState current = start;
+    while (!smoothed.goalAchieved())
+    {
+        const Action& action = smoothed.nextAction();
+        CHECK(!planner.checkCollisionAction(current, action, 1));
+        current.apply(action);
+    }
+    CHECK(current == goal);
+}
+
+TEST_CASE("Async planning with deadline and cancellation")
+{
+    TestModel test("model/3-dof/manipulator_4.xml");
+    ManipulatorPlanner planner(3, test.model, test.data);
+    JointState start(3, 0);
+
+    // unreachable point, so only deadline can stop search
+    astar::SearchControl control(0.2);
+    size_t progressCalls = 0;
+    control.progressPeriod = 100;
+    control.onProgress = [&progressCalls](const astar::SearchProgress& progress)
+    {
+        ++progressCalls;
+        CHECK(progress.bestF >= 0);
+    };
+    astar::Clock::time_point begin = astar::Clock::now();
+    Solution solution = planner.planAsync(start, 10.0, 10.0, ALG_ASTAR, control).get();
+    double elapsed = std::chrono::duration<double>(astar::Clock::now() - begin).count();
+    CHECK(solution.stats.pathVerdict == PATH_NOT_FOUND);
+    CHECK(elapsed < 1.0);
+    CHECK(progressCalls > 0);
+
+    astar::SearchControl endless;
+    std::future<Solution> future = planner.planAsync(start, 10.0, 10.0, ALG_ASTAR, endless);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    endless.token.cancel();
+    CHECK(future.wait_for(std::chrono::seconds(1)) == std::future_status::ready);
+    CHECK(future.get().stats.pathVerdict == PATH_NOT_FOUND);
+
+    // deadline is checked on every expansion
+    astar::SearchControl everyExpansion(0.1);
+    everyExpansion.checkPeriod = 0;
+    CHECK(planner.planAsync(start, 10.0, 10.0, ALG_ASTAR, everyExpansion).get().stats.pathVerdict == PATH_NOT_FOUND);
+}
+
+TEST_CASE("Portfolio planner")
+{
+    TestModel test("model/2-dof/manipulator_5.xml");
+    ManipulatorPlanner planner(2, test.model, test.data);
+    PortfolioPlanner portfolio(planner);
+
+    JointState start({10, 100});
+    JointState goal({60, -100});
+    Solution optimal = planner.planActions(start, goal, ALG_ASTAR, 10.0, 1.0);
+    Solution solution = portfolio.planActions(start, goal, 10.0, 3.0);
+    REQUIRE(solution.stats.pathVerdict == PATH_FOUND);
+    REQUIRE(portfolio.lastWinner() >= 0);
+    CHECK(suboptimalityBound(portfolio.configs()[portfolio.lastWinner()]) <= 3.0);
+    CHECK(solution.stats.pathCost <= 3.0 * optimal.stats.pathCost);
+    JointState current = start;
+    while (!solution.goalAchieved())
+    {
+        current.apply(solution.nextAction());
+    }
+    CHECK(current == goal);
+
+    // unreachable point, nobody can satisfy suboptimality
+    solution = portfolio.planActions(start, 10.0, 10.0, 0.2, 1.0);
+    CHECK(solution.stats.pathVerdict != PATH_FOUND);
+}
+
+TEST_CASE("External memory A* finds optimal path")
+{
+    TestModel test("model/2-dof/manipulator_5.xml");
+    ManipulatorPlanner planner(2, test.model, test.data);
+    astar::ExternalMemoryConfig config;
+    config.memoryNodes = 512; // force using of files
+    config.partitions = 8;
+    planner.setExternalMemoryConfig(config);
+
+    JointState start({10, 100});
+    JointState goal({60, -100});
+    Solution optimal = planner.planActions(start, goal, ALG_ASTAR, 10.0);
+    Solution solution = planner.planActions(start, goal, ALG_ASTAR_EXTERNAL, 10.0);
+    REQUIRE(solution.stats.pathVerdict == PATH_FOUND);
+    CHECK(solution.stats.pathCost == optimal.stats.pathCost);
+    JointState current = start;
+    while (!solution.goalAchieved())
+    {
+        const Action& action = solution.nextAction();
+        CHECK(!planner.checkCollisionAction(current, action));
+        current.apply(action);
+    }
+    CHECK(current == goal);
+}
+
+TEST_CASE("Hierarchical planning over lattice")
+{
+    TestModel test("model/2-dof/manipulator_5.xml");
+    ManipulatorPlanner planner(2, test.model, test.data);
+
+    std::shared_ptr<Lattice> lattice = std::make_shared<Lattice>(2);
+    lattice->build(planner);
+    JointState start({10, 100});
+    JointState goal({60, -100});
+    CHECK(lattice->state(lattice->index(goal)) == goal);
+    CHECK(lattice->isFree(lattice->index(start)) == !planner.checkCollision(start));
+
+    std::shared_ptr<HierarchicalGraph> graph = std::make_shared<HierarchicalGraph>(lattice, 16);
+    REQUIRE(graph->nodes() > 0);
+    TempFile saved;
+    uint64_t hash = modelHash(test.model);
+    graph->save(saved.path, hash);
+    std::shared_ptr<HierarchicalGraph> loaded = std::make_shared<HierarchicalGraph>(lattice, saved.path, hash);
+    CHECK(loaded->nodes() == graph->nodes());
+    CHECK(loaded->edges() == graph->edges());
+    CHECK_THROWS(HierarchicalGraph(lattice, saved.path, hash + 1));
+
+    // kind of data takes 8 bytes of header, longer kinds are rejected
+    FILE* file = std::tmpfile();
+    REQUIRE(file != nullptr);
+    writePrecomputedHeader(file, "roadmap", hash, 2);
+    CHECK_THROWS(writePrecomputedHeader(file, "roadmap_v2", hash, 2));
+    std::rewind(file);
+    CHECK_NOTHROW(readPrecomputedHeader(file, "roadmap", hash, 2));
+    std::rewind(file);
+    CHECK_THROWS(readPrecomputedHeader(file, "roadmaps", hash, 2));
+    std::fclose(file);
+
+    planner.setHierarchicalGraph(loaded);
+    Solution optimal = planner.planActions(start, goal, ALG_ASTAR, 10.0);
+    Solution solution = planner.planActions(start, goal, ALG_HPA);
+    REQUIRE(solution.stats.pathVerdict == PATH_FOUND);
+    CHECK(solution.stats.pathCost >= optimal.stats.pathCost);
+    JointState current = start;
+    while (!solution.goalAchieved())
+    {
+        const Action& action = solution.nextAction();
+        CHECK(!planner.checkCollisionAction(current, action));
+        current.apply(action);
+    }
+    CHECK(current == goal);
+}
+
+TEST_CASE("Contraction hierarchy gives optimal paths")
+{
+    TestModel test("model/2-dof/manipulator_5.xml");
+    ManipulatorPlanner planner(2, test.model, test.data);
+
+    std::shared_ptr<Lattice> lattice = std::make_shared<Lattice>(2);
+    lattice->build(planner);
+    std::shared_ptr<ContractionHierarchy> hierarchy = std::make_shared<ContractionHierarchy>(lattice);
+    TempFile saved;
+    uint64_t hash = modelHash(test.model);
+    hierarchy->save(saved.path, hash);
+    std::shared_ptr<ContractionHierarchy> loaded = std::make_shared<ContractionHierarchy>(lattice, saved.path, hash);
+    CHECK(loaded->edges() == hierarchy->edges());
+    planner.setContractionHierarchy(loaded);
+
+    vector<std::pair<JointState, JointState>> tasks = {
+        {JointState({10, 100}), JointState({60, -100})},
+        {JointState({10, 100}), JointState({10, 100})},
+        {JointState({-120, 5}), JointState({100, -30})},
+        {JointState({0, 0}), JointState({-64, 90})},
+    };
+    for (const auto& task : tasks)
+    {
+        Solution optimal = planner.planActions(task.first, task.second, ALG_ASTAR, 10.0);
+        Solution solution = planner.planActions(task.first, task.second, ALG_CH);
+        CHECK(solution.stats.pathVerdict == optimal.stats.pathVerdict);
+        if (solution.stats.pathVerdict != PATH_FOUND)
+        {
+            continue;
+        }
+        CHECK(solution.stats.pathCost == optimal.stats.pathCost);
+        CHECK(solution.size() == optimal.stats.pathCost);
+        JointState current = task.first;
+        while (!solution.goalAchieved())
+        {
+            const Action& action = solution.nextAction();
+            CHECK(!planner.checkCollisionAction(current, action));
+            current.apply(action);
+        }
+        CHECK(current == task.second);
+    }
+}
+
+TEST_CASE("Compressed path database")
+{
+    TestModel test("model/2-dof/manipulator_5.xml");
+    ManipulatorPlanner planner(2, test.model, test.data);
+
+    std::shared_ptr<Lattice> lattice = std::make_shared<Lattice>(2);
+    lattice->build(planner);
+    std::shared_ptr<CompressedPathDatabase> database = std::make_shared<CompressedPathDatabase>(lattice);
+    TempFile saved;
+    uint64_t hash = modelHash(test.model);
+    database->save(saved.path, hash);
+    std::shared_ptr<CompressedPathDatabase> loaded = std::make_shared<CompressedPathDatabase>(lattice, saved.path, hash);
+    CHECK(loaded->runs() == database->runs());
+    planner.setPathDatabase(loaded);
+
+    vector<std::pair<JointState, JointState>> tasks = {
+        {JointState({10, 100}), JointState({60, -100})},
+        {JointState({-120, 5}), JointState({100, -30})},
+        {JointState({0, 0}), JointState({-64, 90})},
+    };
+    for (const auto& task : tasks)
+    {
+        Solution optimal = planner.planActions(task.first, task.second, ALG_ASTAR, 10.0);
+        Solution solution = planner.planActions(task.first, task.second, ALG_CPD);
+        CHECK(solution.stats.pathVerdict == optimal.stats.pathVerdict);
+        if (solution.stats.pathVerdict != PATH_FOUND)
+        {
+            continue;
+        }
+        CHECK(solution.stats.pathCost == optimal.stats.pathCost);
+        JointState current = task.first;
+        while (!solution.goalAchieved())
+        {
+            const Action& action = solution.nextAction();
+            CHECK(!planner.checkCollisionAction(current, action));
+            current.apply(action);
+        }
+        CHECK(current == task.second);
+    }
+}
+
+TEST_CASE("Components of free space")
+{
+    TestModel test("model/2-dof/manipulator_5.xml");
+    ManipulatorPlanner planner(2, test.model, test.data);
+
+    Lattice lattice(2);
+    lattice.build(planner);
+    ComponentMap components(lattice, planner);
+    REQUIRE(components.components() > 1);
+    TempFile saved;
+    uint64_t hash = modelHash(test.model);
+    components.save(saved.path, hash);
+    std::shared_ptr<ComponentMap> loaded = std::make_shared<ComponentMap>(2, saved.path, hash);
+    CHECK(loaded->components() == components.components());
+
+    JointState start({10, 100});
+    JointState goal({60, -100});
+    JointState other = start;
+    size_t mismatches = 0;
+    for (size_t id = 0; id < lattice.size(); ++id)
+    {
+        JointState state = lattice.state(id);
+        mismatches += loaded->component(state) != components.component(state);
+        mismatches += (components.component(state) == 0) != !lattice.isFree(id);
+        if (lattice.isFree(id) && !components.connected(start, state))
+        {
+            other = state;
+        }
+    }
+    CHECK(mismatches == 0);
+    REQUIRE(other != start);
+    CHECK(components.connected(start, goal));
+
+    Solution solution = planner.planActions(start, other, ALG_ASTAR, 10.0);
+    CHECK(solution.stats.pathVerdict == PATH_NOT_EXISTS);
+    planner.setComponentMap(loaded);
+    solution = planner.planActions(start, other, ALG_ASTAR, 10.0);
+    CHECK(solution.stats.pathVerdict == PATH_NOT_EXISTS);
+    CHECK(solution.stats.expansions == 0);
+    solution = planner.planActions(start, goal, ALG_ASTAR, 10.0);
+    CHECK(solution.stats.pathVerdict == PATH_FOUND);
+
+    // end-effector can not reach this point
+    CHECK(!components.mayReach(start, 10.0, 10.0, g_goalRadius));
+    solution = planner.planActions(start, 10.0, 10.0, ALG_ASTAR, 10.0);
+    CHECK(solution.stats.pathVerdict == PATH_NOT_EXISTS);
+    std::pair<double, double> xy = planner.sitePosition(goal);
+    CHECK(components.mayReach(start, xy.first, xy.second, g_goalRadius));
+    solution = planner.planActions(start, xy.first, xy.second, ALG_ASTAR, 10.0);
+    CHECK(solution.stats.pathVerdict == PATH_FOUND);
+}
+
+TEST_CASE("Experience cache")
+{
+    TestModel test("model/2-dof/manipulator_5.xml");
+    ManipulatorPlanner planner(2, test.model, test.data);
+    ExperienceCache cache(planner, 2);
+
+    JointState start({10, 100});
+    JointState goal({60, -100});
+    Solution solution = cache.planActions(start, goal, 10.0);
+    REQUIRE(solution.stats.pathVerdict == PATH_FOUND);
+    CHECK(cache.size() == 1);
+    CHECK(cache.hits() == 0);
+
+    auto check = [&planner](Solution& solution, JointState current, const JointState& goal)
+    {
+        REQUIRE(solution.stats.pathVerdict == PATH_FOUND);
+        while (!solution.goalAchieved())
+        {
+            const Action& action = solution.nextAction();
+            CHECK(!planner.checkCollisionAction(current, action));
+            current.apply(action);
+        }
+        CHECK(current == goal);
+    };
+    // similar task is solved by stored path
+    JointState nearStart({12, 100});
+    JointState nearGoal({60, -98});
+    REQUIRE(!planner.checkCollision(nearStart));
+    REQUIRE(!planner.checkCollision(nearGoal));
+    solution = cache.planActions(nearStart, nearGoal, 10.0);
+    CHECK(cache.hits() == 1);
+    check(solution, nearStart, nearGoal);
+
+    // position task with the same goal point
+    std::pair<double, double> xy = planner.sitePosition(goal);
+    solution = cache.planActions(nearStart, xy.first, xy.second, 10.0);
+    CHECK(cache.hits() == 2);
+    check(solution, nearStart, goal);
+
+    TempFile saved;
+    cache.save(saved.path);
+    ExperienceCache loaded(planner, 2);
+    CHECK(loaded.load(saved.path));
+    CHECK(loaded.size() == cache.size());
+    solution = loaded.planActions(nearStart, nearGoal, 10.0);
+    CHECK(loaded.hits() == 1);
+    std::remove(saved.path.c_str());
+    CHECK(!loaded.load(saved.path));
+
+    // the least recently used path is evicted
+    cache.planActions(goal, start, 10.0);
+    cache.planActions(JointState({0, 0}), JointState({20, 20}), 10.0);
+    CHECK(cache.size() == 2);
+}
+
+TEST_CASE("Roadmap planner")
+{
+    TestModel test("model/3-dof/manipulator_4.xml");
+    ManipulatorPlanner planner(3, test.model, test.data);
+
+    std::shared_ptr<Roadmap> roadmap = std::make_shared<Roadmap>(planner, 1000);
+    REQUIRE(roadmap->nodes() == 1000);
+    REQUIRE(roadmap->edges() > 0);
+    TempFile saved;
+    uint64_t hash = modelHash(test.model);
+    roadmap->save(saved.path, hash);
+    std::shared_ptr<Roadmap> loaded = std::make_shared<Roadmap>(3, saved.path, hash);
+    CHECK(loaded->nodes() == roadmap->nodes());
+    CHECK(loaded->edges() == roadmap->edges());
+    planner.setRoadmap(loaded);
+
+    // every block of samples has its own random stream
+    Roadmap single(planner, 200, 10, 64, 1);
+    Roadmap parallel(planner, 200, 10, 64, 3);
+    CHECK(single.nodes() == parallel.nodes());
+    CHECK(single.edges() == parallel.edges());
+
+    Random random(3);
+    auto freeState = [&planner, &random]()
+    {
+        JointState state = randomState(random, 3);
+        while (planner.checkCollision(state))
+        {
+            state = randomState(random, 3);
+        }
+        return state;
+    };
+    size_t found = 0;
+    for (size_t task = 0; task < 10; ++task)
+    {
+        JointState start = freeState();
+        JointState goal = freeState();
+        Solution solution = planner.planActions(start, goal, ALG_ROADMAP, 1.0);
+        if (solution.stats.pathVerdict != PATH_FOUND)
+        {
+            continue;
+        }
+        ++found;
+        JointState current = start;
+        while (!solution.goalAchieved())
+        {
+            const Action& action = solution.nextAction();
+            CHECK(planner.isCorrect(current, action));
+            CHECK(!planner.checkCollisionAction(current, action, 1));
+            current.apply(action);
+        }
+        CHECK(current == goal);
+    }
+    CHECK(found > 0);
+}
+
+TEST_CASE("k-d tree nearest neighbour")
+{
+    Random random(7);
+    KdTree tree(3);
+    vector<JointState> points;
+    for (size_t i = 0; i < 500; ++i)
+    {
+        points.push_back(randomState(random, 3));
+        CHECK(tree.insert(points.back()) == i);
+    }
+    size_t mismatches = 0;
+    for (size_t q = 0; q < 200; ++q)
+    {
+        JointState query = randomState(random, 3);
+        int best = manhattanDistance(query, points[0]);
+        for (const JointState& point : points)
+        {
+            best = std::min(best, manhattanDistance(query, point));
+        }
+        mismatches += manhattanDistance(query, tree.point(tree.nearest(query))) != best;
+    }
+    CHECK(mismatches == 0);
+}
+
+TEST_CASE("RRT-Connect planner")
+{
+    TestModel test("model/4-dof/manipulator_4.xml");
+    ManipulatorPlanner planner(4, test.model, test.data);
+
+    Random random(11);
+    auto freeState = [&planner, &random]()
+    {
+        JointState state = randomState(random, 4);
+        while (planner.checkCollision(state))
+        {
+            state = randomState(random, 4);
+        }
+        return state;
+    };
+    size_t found = 0;
+    for (size_t task = 0; task < 5; ++task)
+    {
+        JointState start = freeState();
+        JointState goal = freeState();
+        Solution solution = planner.planActions(start, goal, ALG_RRT_CONNECT, 2.0);
+        if (solution.stats.pathVerdict != PATH_FOUND)
+        {
+            continue;
+        }
+        ++found;
+        JointState current = start;
+        while (!solution.goalAchieved())
+        {
+            const Action& action = solution.nextAction();
+            CHECK(!planner.checkCollisionAction(current, action));
+            current.apply(action);
+        }
+        CHECK(current == goal);
+    }
+    CHECK(found > 0);
+}
+
+TEST_CASE("Distance field and trajectory optimiser")
+{
+    TestModel test("model/2-dof/manipulator_5.xml");
+    ManipulatorPlanner planner(2, test.model, test.data);
+
+    // sphere of radius 0.3 in (0, 1.6), box 0.1 x 0.15 in (0, -0.2)
+    DistanceField field(test.model, 2, 2.5);
+    CHECK(field.exactDistance(0, 1.6) == doctest::Approx(-0.3));
+    CHECK(field.exactDistance(0.5, 1.6) == doctest::Approx(0.2));
+    CHECK(field.exactDistance(0, 0.1) == doctest::Approx(0.15));
+    CHECK(field.distance(0.5, 1.6) == doctest::Approx(0.2).epsilon(0.05));
+
+    Random random(17);
+    auto freeState = [&planner, &random]()
+    {
+        JointState state = randomState(random, 2);
+        while (planner.checkCollision(state))
+        {
+            state = randomState(random, 2);
+        }
+        return state;
+    };
+    size_t found = 0;
+    for (size_t task = 0; task < 5; ++task)
+    {
+        JointState start = freeState();
+        JointState goal = freeState();
+        Solution solution = planner.planActions(start, goal, ALG_OPTIMIZE, 5.0);
+        if (solution.stats.pathVerdict == PATH_NOT_EXISTS) // A* of seed has proved it
+        {
+            continue;
+        }
+        REQUIRE(solution.stats.pathVerdict == PATH_FOUND);
+        ++found;
+        JointState current = start;
+        while (!solution.goalAchieved())
+        {
+            const Action& action = solution.nextAction();
+            CHECK(!planner.checkCollisionAction(current, action));
+            current.apply(action);
+        }
+        CHECK(current == goal);
+    }
+    CHECK(found > 0);
+}
+
+TEST_CASE("Theta* gives any-angle paths")
+{
+    CHECK(euclideanDistance({0, 0}, {3, 4}) == doctest::Approx(5));
+    CHECK(euclideanDistance({-127, 0}, {127, 0}) == doctest::Approx(2)); // joint 0 is cyclic
+
+    TestModel test("model/2-dof/manipulator_5.xml");
+    ManipulatorPlanner planner(2, test.model, test.data);
+
+    Random random(23);
+    auto freeState = [&planner, &random]()
+    {
+        JointState state = randomState(random, 2);
+        while (planner.checkCollision(state))
+        {
+            state = randomState(random, 2);
+        }
+        return state;
+    };
+    size_t found = 0;
+    for (size_t task = 0; task < 5; ++task)
+    {
+        JointState start = freeState();
+        JointState goal = freeState();
+        Solution grid = planner.planActions(start, goal, ALG_ASTAR, 5.0);
+        Solution solution = planner.planActions(start, goal, ALG_THETA, 5.0);
+        REQUIRE(solution.stats.pathVerdict == grid.stats.pathVerdict);
+        if (solution.stats.pathVerdict != PATH_FOUND)
+        {
+            continue;
+        }
+        ++found;
+        // euclidean length of any-angle path is not longer than length of staircase
+        CHECK(solution.stats.pathCost <= grid.stats.pathCost);
+        JointState current = start;
+        while (!solution.goalAchieved())
+        {
+            const Action& action = solution.nextAction();
+            CHECK(action.abs() == 1);
+            CHECK(planner.isCorrect(current, action));
+            CHECK(!planner.checkCollisionAction(current, action, 1));
+            current.apply(action);
+        }
+        CHECK(current == goal);
+    }
+    CHECK(found > 0);
+}
+
+TEST_CASE("Reservation table")
+{
+    ReservationTable table(1.0, 0.1);
+    table.reserve(0, {5, 6});
+    table.reserveFrom(3, {100});
+    CHECK(!table.isFree(0, {6}));
+    CHECK(table.isFree(1, {5, 6}));
+    CHECK(table.isFree(2, {100}));
+    CHECK(!table.isFree(10, {100}));
+    CHECK(table.horizon() == 3);
+}
+
+TEST_CASE("Prioritised planning for two arms")
+{
+    TestModel test("model/2-arms/manipulator_2.xml");
+    MultiArmPlanner planner({2, 2}, test.model);
+    REQUIRE(planner.arms() == 2);
+
+    // arms collide when they point to each other
+    CHECK(!planner.checkCollision({{0, 0}, {64, 0}}));
+    CHECK(planner.checkCollision({{0, 0}, {-128, 0}}));
+
+    Random random(5);
+    for (size_t task = 0; task < 5; ++task)
+    {
+        vector<JointState> starts;
+        vector<JointState> goals;
+        do
+        {
+            starts = {randomState(random, 2), randomState(random, 2)};
+        } while (planner.checkCollision(starts));
+        do
+        {
+            goals = {randomState(random, 2), randomState(random, 2)};
+        } while (planner.checkCollision(goals));
+
+        MultiArmSolution solution = planner.plan(starts, goals, astar::SearchControl(10.0));
+        REQUIRE(solution.stats.pathVerdict == PATH_FOUND);
+        REQUIRE(solution.arms[0].size() == solution.arms[1].size());
+        vector<JointState> current = starts;
+        size_t collisions = 0;
+        for (size_t k = 0; k < solution.arms[0].size(); ++k)
+        {
+            for (size_t arm = 0; arm < 2; ++arm)
+            {
+                current[arm].apply(solution.arms[arm].getAction(k));
+            }
+            collisions += planner.checkCollision(current);
+        }
+        CHECK(collisions == 0);
+        CHECK(current[0] == goals[0]);
+        CHECK(current[1] == goals[1]);
+    }
+
+    // contact pair of two obstacles does not belong to any arm
+    TestModel pair("model/2-arms/manipulator_2.xml",
+        {{"</contact>", "<pair geom1=\"geom obstacle 0\" geom2=\"geom obstacle 1\"/>\n</contact>"}});
+    MultiArmPlanner obstacles({2, 2}, pair.model);
+    CHECK(!obstacles.checkCollision({{0, 0}, {64, 0}}));
+    CHECK(obstacles.checkCollision({{0, 0}, {-128, 0}}));
+}
+
+TEST_CASE("Symmetry reduction gives optimal paths")
+{
+    TestModel test("model/2-dof/manipulator_5.xml");
+    ManipulatorPlanner planner(2, test.model, test.data);
+
+    std::shared_ptr<Lattice> lattice = std::make_shared<Lattice>(2);
+    lattice->build(planner);
+    std::shared_ptr<SymmetryReduction> reduction = std::make_shared<SymmetryReduction>(lattice);
+    size_t freeStates = 0;
+    for (size_t id = 0; id < lattice->size(); ++id)
+    {
+        freeStates += lattice->isFree(id);
+    }
+    CHECK(reduction->keptStates() < freeStates);
+    TempFile saved;
+    uint64_t hash = modelHash(test.model);
+    reduction->save(saved.path, hash);
+    std::shared_ptr<SymmetryReduction> loaded = std::make_shared<SymmetryReduction>(lattice, saved.path, hash);
+    CHECK(loaded->boxes() == reduction->boxes());
+    CHECK(loaded->keptStates() == reduction->keptStates());
+    planner.setSymmetryReduction(loaded);
+
+    vector<std::pair<JointState, JointState>> tasks = {
+        {JointState({10, 100}), JointState({60, -100})},
+        {JointState({10, 100}), JointState({10, 100})},
+        {JointState({-120, 5}), JointState({100, -30})},
+        {JointState({0, 0}), JointState({-64, 90})},
+        {JointState({-20, 40}), JointState({-10, 50})},
+    };
+    for (const auto& task : tasks)
+    {
+        Solution optimal = planner.planActions(task.first, task.second, ALG_ASTAR, 10.0);
+        Solution solution = planner.planActions(task.first, task.second, ALG_RSR);
+        CHECK(solution.stats.pathVerdict == optimal.stats.pathVerdict);
+        if (solution.stats.pathVerdict != PATH_FOUND)
+        {
+            continue;
+        }
+        CHECK(solution.stats.pathCost == optimal.stats.pathCost);
+        CHECK(solution.stats.expansions <= optimal.stats.expansions);
+        JointState current = task.first;
+        while (!solution.goalAchieved())
+        {
+            const Action& action = solution.nextAction();
+            CHECK(!planner.checkCollisionAction(current, action));
+            current.apply(action);
+        }
+        CHECK(current == task.second);
+    }
+}